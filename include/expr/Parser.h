@@ -222,7 +222,8 @@ namespace expr {
     virtual Decl *ParseTopLevelDecl() = 0;
 
     /// CreateParser - Create a parser implementation for the given
-    /// MemoryBuffer.
+    /// MemoryBuffer. Binary query logs (see ExprBinaryWriter) are
+    /// recognized by their header and read as a sequence of queries.
     ///
     /// \arg Name - The name to use in diagnostic messages.
     /// \arg MB - The input data.
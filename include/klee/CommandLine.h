@@ -31,6 +31,8 @@ extern llvm::cl::opt<bool> UseForkedCoreSolver;
 
 extern llvm::cl::opt<bool> CoreSolverOptimizeDivides;
 
+extern llvm::cl::opt<unsigned> SolverConstructCacheSize;
+
 extern llvm::cl::opt<bool> UseAssignmentValidatingSolver;
 
 ///The different query logging solvers that can switched on/off
@@ -39,7 +41,9 @@ enum QueryLoggingSolverType
     ALL_KQUERY,   ///< Log all queries (un-optimised) in .kquery (KQuery) format
     ALL_SMTLIB,   ///< Log all queries (un-optimised)  .smt2 (SMT-LIBv2) format
     SOLVER_KQUERY,///< Log queries passed to solver (optimised) in .kquery (KQuery) format
-    SOLVER_SMTLIB ///< Log queries passed to solver (optimised) in .smt2 (SMT-LIBv2) format
+    SOLVER_SMTLIB,///< Log queries passed to solver (optimised) in .smt2 (SMT-LIBv2) format
+    ALL_BINARY,   ///< Log all queries (un-optimised) in binary .kqb format
+    SOLVER_BINARY ///< Log queries passed to solver (optimised) in binary .kqb format
 };
 
 extern llvm::cl::bits<QueryLoggingSolverType> queryLoggingOptions;
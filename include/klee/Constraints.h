@@ -12,6 +12,8 @@
 
 #include "klee/Expr.h"
 
+#include <map>
+
 // FIXME: Currently we use ConstraintManager for two things: to pass
 // sets of constraints around, and to optimize constraints. We should
 // move the first usage into a separate data structure
@@ -44,6 +46,10 @@ public:
   ref<Expr> simplifyExpr(ref<Expr> e) const;
 
   void addConstraint(ref<Expr> e);
+
+  // replace each key of equalities by its value in the existing
+  // constraints; the equalities must be implied by the path
+  void rewriteEqualities(const std::map< ref<Expr>, ref<Expr> > &equalities);
   
   bool empty() const {
     return constraints.empty();
@@ -20,6 +20,7 @@
 #include "klee/Internal/Module/KInstIterator.h"
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -41,7 +42,12 @@ struct StackFrame {
   CallPathNode *callPathNode;
 
   std::vector<const MemoryObject *> allocas;
+
+  /// Register values. Copies of a frame (made when a state forks) share
+  /// them until one of the copies writes to them, writes must therefore
+  /// go through getLocalsForWrite().
   Cell *locals;
+  std::shared_ptr<Cell> localsOwner;
 
   /// Minimum distance to an uncovered instruction once the function
   /// returns. This is not a good place for this but is used to
@@ -59,7 +65,18 @@ struct StackFrame {
 
   StackFrame(KInstIterator caller, KFunction *kf);
   StackFrame(const StackFrame &s);
-  ~StackFrame();
+
+  Cell *getLocalsForWrite() {
+    if (localsOwner.use_count() != 1)
+      copyLocals();
+    return locals;
+  }
+
+  /// Whether the register values are shared with another frame.
+  bool sharesLocals() const { return localsOwner.use_count() != 1; }
+
+private:
+  void copyLocals();
 };
 
 /// @brief ExecutionState representing a path under exploration
@@ -98,11 +115,18 @@ public:
   /// @brief Constraints collected so far
   ConstraintManager constraints;
 
+  /// @brief A branch condition not yet known to be feasible, which is
+  /// added to the constraints before the state runs (see --seed-concolic)
+  ref<Expr> pendingConstraint;
+
   /// Statistics and information
 
   /// @brief Costs for all queries issued for this state, in seconds
   mutable double queryCost;
 
+  /// @brief Number of solver queries issued for this state
+  mutable uint64_t queryCount;
+
   /// @brief Weight assigned for importance of this state.  Can be
   /// used for searchers to decide what paths to explore
   double weight;
@@ -173,6 +197,11 @@ public:
 
   bool merge(const ExecutionState &b);
   void dumpStack(llvm::raw_ostream &out) const;
+
+  /// @brief Estimate of the memory (in bytes) uniquely owned by this
+  /// state, i.e. what is reclaimed when the state is terminated. Objects
+  /// shared copy-on-write with other states are not included.
+  size_t getOwnedMemoryUsage() const;
 };
 }
 
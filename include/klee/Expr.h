@@ -33,6 +33,7 @@ namespace klee {
 
 class Array;
 class ArrayCache;
+class ArraySummary;
 class ConstantExpr;
 class ObjectState;
 
@@ -498,6 +499,9 @@ public:
 private:
   unsigned hashValue;
 
+  /// The summary of the constant values, computed on first use.
+  mutable ArraySummary *summary;
+
   // FIXME: Make =delete when we switch to C++11
   Array(const Array& array);
 
@@ -527,6 +531,11 @@ public:
   Expr::Width getDomain() const { return domain; }
   Expr::Width getRange() const { return range; }
 
+  /// getSummary - Return the summary of the constant values of this array,
+  /// or null if this is a symbolic array or its values are wider than 64
+  /// bits.
+  const ArraySummary *getSummary() const;
+
   /// ComputeHash must take into account the name, the size, the domain, and the range
   unsigned computeHash();
   unsigned hash() const { return hashValue; }
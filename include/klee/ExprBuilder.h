@@ -74,6 +74,11 @@ namespace klee {
   /// folding.
   ExprBuilder *createDefaultExprBuilder();
 
+  /// createCanonicalExprBuilder - Create an expression builder which uses
+  /// the Expr::create functions, and so folds and canonicalizes
+  /// expressions the same way the rest of KLEE does.
+  ExprBuilder *createCanonicalExprBuilder();
+
   /// createConstantFoldingExprBuilder - Create an expression builder which
   /// folds constant expressions.
   ///
@@ -86,6 +91,19 @@ namespace klee {
   ///
   /// Base - The base builder to use when constructing expressions.
   ExprBuilder *createSimplifyingExprBuilder(ExprBuilder *Base);
+
+  /// createRewritingExprBuilder - Create an expression builder which applies
+  /// a table of local rewrite rules (bit-level simplification,
+  /// extract/concat fusion, select lifting and arithmetic
+  /// canonicalization) before handing expressions to its base. Rules can
+  /// be turned off with -disable-rewrite.
+  ///
+  /// Base - The base builder to use when constructing expressions.
+  ExprBuilder *createRewritingExprBuilder(ExprBuilder *Base);
+
+  /// printExprRewriteStats - Print how often each rewrite rule applied,
+  /// over all rewriting builders.
+  void printExprRewriteStats(llvm::raw_ostream &os);
 }
 
 #endif
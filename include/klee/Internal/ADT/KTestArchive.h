@@ -0,0 +1,61 @@
+//===-- KTestArchive.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __COMMON_KTESTARCHIVE_H__
+#define __COMMON_KTESTARCHIVE_H__
+
+#include "klee/Internal/ADT/KTest.h"
+
+/* A .ktar archive holds many test cases in a single file. Tests are
+   appended as they are generated, object contents which occur in more
+   than one test are stored once, and an index written when the archive
+   is closed gives random access to each test. An archive which was not
+   closed (e.g. because KLEE crashed) is still readable; its index is
+   rebuilt by scanning the file. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct KTestArchive KTestArchive;
+  typedef struct KTestArchiveWriter KTestArchiveWriter;
+
+  /* return true iff file at path matches KTestArchive header */
+  int kTestArchive_isArchiveFile(const char *path);
+
+  /* returns NULL on (unspecified) error */
+  KTestArchive *kTestArchive_open(const char *path);
+
+  /* returns the number of tests in the archive */
+  unsigned kTestArchive_numTests(KTestArchive *);
+
+  /* returns the id the test at index was added with */
+  unsigned kTestArchive_getId(KTestArchive *, unsigned index);
+
+  /* returns the test at index, to be freed with kTest_free, or NULL on
+     (unspecified) error */
+  KTest *kTestArchive_getTest(KTestArchive *, unsigned index);
+
+  void kTestArchive_close(KTestArchive *);
+
+  /* creates a new archive at path, returns NULL on (unspecified) error */
+  KTestArchiveWriter *kTestArchive_create(const char *path);
+
+  /* appends a test, returns 1 on success, 0 on (unspecified) error */
+  int kTestArchive_add(KTestArchiveWriter *, unsigned id, KTest *);
+
+  /* writes the index and frees the writer, returns 1 on success, 0 on
+     (unspecified) error */
+  int kTestArchive_finish(KTestArchiveWriter *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
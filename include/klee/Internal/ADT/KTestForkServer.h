@@ -0,0 +1,35 @@
+//===-- KTestForkServer.h ---------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __COMMON_KTESTFORKSERVER_H__
+#define __COMMON_KTESTFORKSERVER_H__
+
+/* Protocol between `klee-replay --fork-server` and programs linked with
+   libkleeRuntest.
+
+   The driver starts the program with KTEST_FORK_SERVER_ENV set to
+   "<control fd>,<status fd>,<shared memory fd>". At its first call to
+   klee_make_symbolic(), the program becomes a fork server: it writes a
+   32-bit hello to the status fd, and then for each 32-bit test size read
+   from the control fd it forks a child, writes the child's pid to the
+   status fd, waits for it and writes its wait() status. The child reads
+   the test from the first size bytes of the shared memory and continues
+   where the server stopped. The server exits once the control fd is
+   closed.
+
+   A test in shared memory is laid out as (native byte order):
+     uint32 numObjects
+     numObjects * (uint32 nameSize, uint32 numBytes,
+                   nameSize bytes of NUL-terminated name,
+                   numBytes bytes of data) */
+
+#define KTEST_FORK_SERVER_ENV "KLEE_REPLAY_FORK_SERVER"
+#define KTEST_FORK_SERVER_HELLO 0x6b666f72u
+
+#endif
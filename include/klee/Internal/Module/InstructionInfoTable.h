@@ -10,9 +10,11 @@
 #ifndef KLEE_LIB_INSTRUCTIONINFOTABLE_H
 #define KLEE_LIB_INSTRUCTIONINFOTABLE_H
 
-#include <map>
+#include "llvm/ADT/DenseMap.h"
+
 #include <string>
 #include <set>
+#include <vector>
 
 namespace llvm {
   class Function;
@@ -50,7 +52,9 @@ namespace klee {
 
     std::string dummyString;
     InstructionInfo dummyInfo;
-    std::map<const llvm::Instruction*, InstructionInfo> infos;
+    /// Indexed by InstructionInfo::id.
+    std::vector<InstructionInfo> infos;
+    llvm::DenseMap<const llvm::Instruction*, unsigned> ids;
     std::set<const std::string *, ltstr> internedStrings;
 
   private:
@@ -106,6 +106,11 @@ namespace klee {
     // Mark function with functionName as part of the KLEE runtime
     void addInternalFunction(const char* functionName);
 
+    /// Run the passes establishing the invariants the Executor relies on
+    /// and link in the intrinsic library.
+    void runPreparationPasses(const Interpreter::ModuleOptions &opts,
+                              const std::string &intrinsicLibPath);
+
   public:
     KModule(llvm::Module *_module);
     ~KModule();
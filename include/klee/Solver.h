@@ -253,6 +253,12 @@ namespace klee {
   Solver *createKQueryLoggingSolver(Solver *s, std::string path,
                                 int minQueryTimeToLog);
 
+  /// createBinaryQueryLoggingSolver - Create a solver which will forward all
+  /// queries after writing them to the given path in the binary format of
+  /// ExprBinaryWriter.
+  Solver *createBinaryQueryLoggingSolver(Solver *s, std::string path,
+                                         int minQueryTimeToLog);
+
   /// createSMTLIBLoggingSolver - Create a solver which will forward all queries
   /// after writing them to the given path in .smt2 format.
   Solver *createSMTLIBLoggingSolver(Solver *s, std::string path,
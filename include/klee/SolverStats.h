@@ -25,6 +25,8 @@ namespace stats {
   extern Statistic queryCexCacheMisses;
   extern Statistic queryConstructTime;
   extern Statistic queryConstructs;
+  extern Statistic queryConstructCacheHits;
+  extern Statistic queryConstructCacheMisses;
   extern Statistic queryCounterexamples;
   extern Statistic queryTime;
   
@@ -14,6 +14,7 @@
 
 #include <vector>
 #include <string>
+#include <assert.h>
 #include <string.h>
 
 namespace klee {
@@ -46,11 +47,39 @@ namespace klee {
     StatisticRecord *contextStats;
     unsigned index;
 
+    /// Column of each statistic in the indexed storage, or -1 if the
+    /// statistic is not kept per index.
+    std::vector<int> indexedColumns;
+    unsigned numIndexedColumns;
+    /// Distance between consecutive indices and consecutive columns in
+    /// indexedStats; this selects between a row (per-index) and a column
+    /// (per-statistic) layout without branching on access.
+    unsigned indexStride, columnStride;
+
+    uint64_t &indexedSlot(int column, unsigned index) const {
+      return indexedStats[index*indexStride + column*columnStride];
+    }
+
   public:
     StatisticManager();
     ~StatisticManager();
 
-    void useIndexedStats(unsigned totalIndices);
+    /// setIndexed - Keep per index values for \arg s. Statistics are
+    /// laid out in the order they are selected, so the most frequently
+    /// updated ones should come first. Must be called before
+    /// useIndexedStats.
+    void setIndexed(const Statistic &s);
+    bool isIndexed(const Statistic &s) const {
+      return indexedColumns[s.id] >= 0;
+    }
+
+    /// useIndexedStats - Allocate per index storage for the statistics
+    /// selected with setIndexed. If \arg columnMajor is set, the values
+    /// of each statistic are stored contiguously, which suits passes
+    /// walking one statistic over all indices; otherwise the values for
+    /// one index are, which suits per-instruction updates.
+    void useIndexedStats(unsigned totalIndices, bool columnMajor = false);
+    bool hasIndexedStats() const { return indexedStats != 0; }
 
     StatisticRecord *getContext();
     void setContext(StatisticRecord *sr); /* null to reset */
@@ -78,7 +107,9 @@ namespace klee {
     if (enabled) {
       globalStats[s.id] += addend;
       if (indexedStats) {
-        indexedStats[index*stats.size() + s.id] += addend;
+        int column = indexedColumns[s.id];
+        if (column >= 0)
+          indexedSlot(column, index) += addend;
         if (contextStats)
           contextStats->data[s.id] += addend;
       }
@@ -136,18 +167,21 @@ namespace klee {
   inline void StatisticManager::incrementIndexedValue(const Statistic &s, 
                                                       unsigned index,
                                                       uint64_t addend) const {
-    indexedStats[index*stats.size() + s.id] += addend;
+    assert(isIndexed(s) && "statistic is not indexed");
+    indexedSlot(indexedColumns[s.id], index) += addend;
   }
 
   inline uint64_t StatisticManager::getIndexedValue(const Statistic &s, 
                                                     unsigned index) const {
-    return indexedStats[index*stats.size() + s.id];
+    int column = indexedColumns[s.id];
+    return column >= 0 ? indexedSlot(column, index) : 0;
   }
 
   inline void StatisticManager::setIndexedValue(const Statistic &s, 
                                                 unsigned index,
                                                 uint64_t value) {
-    indexedStats[index*stats.size() + s.id] = value;
+    assert(isIndexed(s) && "statistic is not indexed");
+    indexedSlot(indexedColumns[s.id], index) = value;
   }
 }
 
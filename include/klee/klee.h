@@ -111,6 +111,10 @@ extern "C" {
   void klee_warning_once(const char *message);
   void klee_prefer_cex(void *object, uintptr_t condition);
   void klee_posix_prefer_cex(void *object, uintptr_t condition);
+  /* Copy count bytes from src to dst directly on the underlying memory
+     objects. Both addresses and count must be constant and each range
+     must lie within a single object. */
+  void klee_posix_copy_file_data(void *dst, const void *src, size_t count);
   void klee_mark_global(void *object);
 
   /* Return a possible constant value for the input expression. This
@@ -0,0 +1,88 @@
+//===-- ArraySummary.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_ARRAYSUMMARY_H
+#define KLEE_ARRAYSUMMARY_H
+
+#include "klee/Expr.h"
+
+#include <vector>
+
+namespace klee {
+
+/// ArraySummary - Facts about the contents of an all-constant array, used to
+/// fold reads at a symbolic index into expressions over the index alone.
+///
+/// The summary is computed once per array (see Array::getSummary) and is an
+/// inverse map from each distinct value to the maximal segments of indices it
+/// is stored at. Monotonic runs of the array show up as adjacent segments of
+/// successive values, which merge into a single index range when a read is
+/// compared against a constant.
+class ArraySummary {
+public:
+  /// Segment - The indices [begin, end] of the array.
+  struct Segment {
+    uint64_t begin, end;
+
+    Segment(uint64_t _begin, uint64_t _end) : begin(_begin), end(_end) {}
+
+    bool operator<(const Segment &b) const { return begin < b.begin; }
+  };
+
+  /// Entry - A distinct value of the array and where it is stored.
+  struct Entry {
+    ref<ConstantExpr> value;
+    std::vector<Segment> segments;
+    /// Bit i is set iff value is stored at index i. Only meaningful if the
+    /// array has a bitmap (see hasBitmap).
+    uint64_t bitmap;
+
+    Entry(const ref<ConstantExpr> &_value) : value(_value), bitmap(0) {}
+  };
+
+  /// The distinct values of the array, in increasing unsigned order. The
+  /// first and last entry give the range of values.
+  std::vector<Entry> entries;
+
+  /// The total number of segments of all entries.
+  uint64_t numSegments;
+
+  /// Whether element i is base + stride * i, modulo the range of the array.
+  bool isLinear;
+  ref<ConstantExpr> base, stride;
+
+  /// The size of the array.
+  uint64_t size;
+
+public:
+  explicit ArraySummary(const Array &array);
+
+  /// hasBitmap - Whether the array is small enough for the index set of each
+  /// entry to be kept as a 64-bit bitmap.
+  bool hasBitmap() const { return size <= 64; }
+
+  /// Return the entry for the given value, or null if the array does not
+  /// contain it.
+  const Entry *getEntry(const ref<ConstantExpr> &value) const;
+
+  /// Folds built from summaries treat indices past the end of the array as
+  /// don't-cares, which is only sound if every read of a constant array is
+  /// known to be in bounds. Reads are therefore only folded once a client
+  /// which guarantees this, such as the executor which checks each memory
+  /// access before making it, enables folding.
+  static void setInBoundsReads(bool inBounds) { inBoundsReads = inBounds; }
+  static bool hasInBoundsReads() { return inBoundsReads; }
+
+private:
+  static bool inBoundsReads;
+};
+
+}
+
+#endif
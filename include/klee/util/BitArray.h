@@ -35,6 +35,34 @@ public:
   void set(unsigned idx) { bits[idx/32] |= 1<<(idx&0x1F); }
   void unset(unsigned idx) { bits[idx/32] &= ~(1<<(idx&0x1F)); }
   void set(unsigned idx, bool value) { if (value) set(idx); else unset(idx); }
+
+  /// Return whether all of the count bits starting at idx are set, testing
+  /// a word at a time.
+  bool isAllSet(unsigned idx, unsigned count) {
+    while (count) {
+      unsigned shift = idx & 0x1F, n = 32 - shift;
+      if (n > count)
+        n = count;
+      uint32_t mask = (n == 32 ? ~0U : (1U << n) - 1) << shift;
+      if ((bits[idx/32] & mask) != mask)
+        return false;
+      idx += n;
+      count -= n;
+    }
+    return true;
+  }
+
+  /// Set the count bits starting at idx, a word at a time.
+  void setRange(unsigned idx, unsigned count) {
+    while (count) {
+      unsigned shift = idx & 0x1F, n = 32 - shift;
+      if (n > count)
+        n = count;
+      bits[idx/32] |= (n == 32 ? ~0U : (1U << n) - 1) << shift;
+      idx += n;
+      count -= n;
+    }
+  }
 };
 
 } // End klee namespace
@@ -0,0 +1,124 @@
+//===-- ExprBinaryLog.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRBINARYLOG_H
+#define KLEE_EXPRBINARYLOG_H
+
+#include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace klee {
+  class ArrayCache;
+  class ExprBuilder;
+
+  /// A query as stored in a binary query log.
+  struct BinaryQueryRecord {
+    enum Kind {
+      Truth,
+      Validity,
+      Value,
+      InitialValues
+    };
+
+    Kind kind;
+    std::vector< ref<Expr> > constraints;
+    /// The queried expression; for Value queries, the expression whose
+    /// value is requested.
+    ref<Expr> expr;
+    /// The arrays whose values are requested, for InitialValues queries.
+    std::vector<const Array*> objects;
+    bool success;
+    /// The answer: the truth value, the validity (+1, 0 or -1), the
+    /// value (if at most 64 bits wide), or whether a solution exists.
+    int64_t result;
+    /// Solver time in microseconds.
+    uint64_t time;
+
+    BinaryQueryRecord()
+      : kind(Truth), success(false), result(0), time(0) {}
+  };
+
+  /// ExprBinaryWriter - Serializes queries in a compact binary format.
+  ///
+  /// Expression nodes, update list nodes and arrays are written once,
+  /// the first time a query refers to them, and afterwards referenced by
+  /// number; shared subexpressions are therefore stored only once per
+  /// log. The tables are reset once they grow beyond a fixed size, so
+  /// the memory kept alive by the writer stays bounded.
+  class ExprBinaryWriter {
+    llvm::raw_ostream &os;
+    ExprHashMap<unsigned> exprIDs;
+    std::map<const UpdateNode*, unsigned> updateIDs;
+    /// Keeps the update nodes in updateIDs alive, so their addresses
+    /// cannot be reused by other nodes.
+    std::vector<UpdateList> updateLists;
+    std::map<const Array*, unsigned> arrayIDs;
+
+    void writeVarint(uint64_t value);
+    void writeAPInt(const llvm::APInt &value);
+    unsigned defineArray(const Array *array);
+    unsigned defineUpdates(const UpdateList &updates);
+    unsigned defineExpr(const ref<Expr> &e);
+    void reset();
+
+  public:
+    explicit ExprBinaryWriter(llvm::raw_ostream &_os);
+
+    /// Write the file header; must be called once before any query.
+    void writeHeader();
+
+    /// Write \a query along with any definitions it needs.
+    void writeQuery(const BinaryQueryRecord &query);
+  };
+
+  /// ExprBinaryReader - Reads a log written by ExprBinaryWriter from
+  /// memory, for instance a memory mapped file.
+  class ExprBinaryReader {
+    const unsigned char *pos, *end;
+    ArrayCache &arrayCache;
+    ExprBuilder *builder;
+    std::vector< ref<Expr> > exprs;
+    std::vector<UpdateList> updates;
+    std::vector<const Array*> arrays;
+    std::string error;
+
+    bool readVarint(uint64_t &value);
+    bool readID(unsigned &id);
+    bool readAPInt(llvm::APInt &value);
+    bool readExprRef(ref<Expr> &e);
+    bool readArrayRef(const Array *&array);
+    bool readArray();
+    bool readUpdate();
+    bool readExpr();
+    bool fail(const std::string &message);
+
+  public:
+    ExprBinaryReader(const char *begin, const char *end,
+                     ArrayCache &_arrayCache, ExprBuilder *_builder);
+
+    /// Return true if the buffer starts with a binary log header.
+    static bool isBinaryLog(const char *begin, const char *end);
+
+    /// Read the next query into \a query. Returns false at the end of
+    /// the log or on malformed input, in which case getError() is set.
+    bool readQuery(BinaryQueryRecord &query);
+
+    const std::string &getError() const { return error; }
+  };
+}
+
+#endif
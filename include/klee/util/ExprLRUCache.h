@@ -0,0 +1,73 @@
+//===-- ExprLRUCache.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRLRUCACHE_H
+#define KLEE_EXPRLRUCACHE_H
+
+#include "klee/util/ExprHashMap.h"
+
+#include <list>
+#include <utility>
+
+namespace klee {
+
+  /// A map from expressions to values which holds at most a fixed number
+  /// of entries, evicting the least recently used one when full. A
+  /// capacity of 0 means unbounded.
+  template<class T>
+  class ExprLRUCache {
+    typedef std::list<std::pair<ref<Expr>, T> > entries_ty;
+
+    /// Entries, the most recently used first.
+    entries_ty entries;
+    ExprHashMap<typename entries_ty::iterator> index;
+    size_t capacity;
+
+  public:
+    explicit ExprLRUCache(size_t _capacity = 0) : capacity(_capacity) {}
+
+    /// Look up \a e, marking it as most recently used.
+    bool find(const ref<Expr> &e, T &result) {
+      typename ExprHashMap<typename entries_ty::iterator>::iterator it =
+        index.find(e);
+      if (it == index.end())
+        return false;
+      entries.splice(entries.begin(), entries, it->second);
+      result = it->second->second;
+      return true;
+    }
+
+    void insert(const ref<Expr> &e, const T &value) {
+      typename ExprHashMap<typename entries_ty::iterator>::iterator it =
+        index.find(e);
+      if (it != index.end()) {
+        it->second->second = value;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+      }
+
+      entries.push_front(std::make_pair(e, value));
+      index.insert(std::make_pair(e, entries.begin()));
+      if (capacity && index.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+      }
+    }
+
+    void clear() {
+      index.clear();
+      entries.clear();
+    }
+
+    size_t size() const { return index.size(); }
+  };
+
+}
+
+#endif
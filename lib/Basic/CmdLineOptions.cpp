@@ -71,13 +71,21 @@ CoreSolverOptimizeDivides("solver-optimize-divides",
                           cl::desc("Optimize constant divides into add/shift/multiplies before passing to core SMT solver (default=off)"),
                           cl::init(false));
 
+cl::opt<unsigned>
+SolverConstructCacheSize("solver-construct-cache-size",
+                         cl::desc("Number of translated expressions the core SMT solver keeps across queries, "
+                                  "least recently used first out; 0 clears them after every query (default=65536)"),
+                         cl::init(65536));
+
 cl::bits<QueryLoggingSolverType>
 queryLoggingOptions("use-query-log",
                     cl::desc("Log queries to a file. Multiple options can be specified separated by a comma. By default nothing is logged."),
                     cl::values(clEnumValN(ALL_KQUERY,"all:kquery","All queries in .kquery (KQuery) format"),
                                clEnumValN(ALL_SMTLIB,"all:smt2","All queries in .smt2 (SMT-LIBv2) format"),
                                clEnumValN(SOLVER_KQUERY,"solver:kquery","All queries reaching the solver in .kquery (KQuery) format"),
-                               clEnumValN(SOLVER_SMTLIB,"solver:smt2","All queries reaching the solver in .smt2 (SMT-LIBv2) format")
+                               clEnumValN(SOLVER_SMTLIB,"solver:smt2","All queries reaching the solver in .smt2 (SMT-LIBv2) format"),
+                               clEnumValN(ALL_BINARY,"all:binary","All queries in binary .kqb format"),
+                               clEnumValN(SOLVER_BINARY,"solver:binary","All queries reaching the solver in binary .kqb format")
                                KLEE_LLVM_CL_VAL_END),
                     cl::CommaSeparated);
 
@@ -20,7 +20,9 @@ Solver *constructSolverChain(Solver *coreSolver,
                              std::string querySMT2LogPath,
                              std::string baseSolverQuerySMT2LogPath,
                              std::string queryKQueryLogPath,
-                             std::string baseSolverQueryKQueryLogPath) {
+                             std::string baseSolverQueryKQueryLogPath,
+                             std::string queryBinaryLogPath,
+                             std::string baseSolverQueryBinaryLogPath) {
   Solver *solver = coreSolver;
 
   if (queryLoggingOptions.isSet(SOLVER_KQUERY)) {
@@ -37,6 +39,13 @@ Solver *constructSolverChain(Solver *coreSolver,
                  baseSolverQuerySMT2LogPath.c_str());
   }
 
+  if (queryLoggingOptions.isSet(SOLVER_BINARY)) {
+    solver = createBinaryQueryLoggingSolver(
+        solver, baseSolverQueryBinaryLogPath, MinQueryTimeToLog);
+    klee_message("Logging queries that reach solver in .kqb format to %s\n",
+                 baseSolverQueryBinaryLogPath.c_str());
+  }
+
   if (UseAssignmentValidatingSolver)
     solver = createAssignmentValidatingSolver(solver);
 
@@ -68,6 +77,14 @@ Solver *constructSolverChain(Solver *coreSolver,
     klee_message("Logging all queries in .smt2 format to %s\n",
                  querySMT2LogPath.c_str());
   }
+
+  if (queryLoggingOptions.isSet(ALL_BINARY)) {
+    solver = createBinaryQueryLoggingSolver(solver, queryBinaryLogPath,
+                                            MinQueryTimeToLog);
+    klee_message("Logging all queries in .kqb format to %s\n",
+                 queryBinaryLogPath.c_str());
+  }
+
   if (DebugCrossCheckCoreSolverWith != NO_SOLVER) {
     Solver *oracleSolver = createCoreSolver(DebugCrossCheckCoreSolverWith);
     solver = createValidatingSolver(/*s=*/solver, /*oracle=*/oracleSolver);
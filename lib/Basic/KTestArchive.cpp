@@ -0,0 +1,502 @@
+//===-- KTestArchive.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/KTestArchive.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MD5.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Layout (all integers big-endian, strings as in .ktest files):
+//
+//   header:  KTAR_MAGIC, uint32 version
+//   records: a tag byte followed by
+//     'P':   uint32 size, bytes                        (an object payload)
+//     'T':   uint32 id, uint32 numArgs, args, uint32 symArgvs,
+//            uint32 symArgvLen, uint32 numObjects,
+//            numObjects * (name, uint32 payload index) (a test)
+//     'I':   uint32 numPayloads, numPayloads * uint64 offset,
+//            uint32 numTests, numTests * (uint32 id, uint64 offset)
+//   trailer: uint64 offset of the 'I' record, KTAR_INDEX_MAGIC
+//
+// Payloads are numbered in the order they are written, and always
+// precede the first test using them.
+
+#define KTAR_VERSION 1
+#define KTAR_MAGIC_SIZE 5
+#define KTAR_MAGIC "KTARC"
+#define KTAR_INDEX_MAGIC "KTIDX"
+#define KTAR_TRAILER_SIZE (8 + KTAR_MAGIC_SIZE)
+
+#define KTAR_PAYLOAD 'P'
+#define KTAR_TEST 'T'
+#define KTAR_INDEX 'I'
+
+typedef std::vector<std::pair<unsigned, uint64_t> > TestIndex;
+
+struct KTestArchive {
+  FILE *f;
+  std::vector<uint64_t> payloads;
+  TestIndex tests;
+};
+
+struct KTestArchiveWriter {
+  FILE *f;
+  /// Set once a write failed, after which the file is not extended.
+  bool failed;
+  /// The payloads written so far, by digest and size of their contents
+  /// (see payloadKey). The contents themselves are only kept in the file.
+  std::unordered_map<std::string, unsigned> payloadIds;
+  std::vector<uint64_t> payloads;
+  TestIndex tests;
+};
+
+/***/
+
+static int read_uint32(FILE *f, unsigned *value_out) {
+  unsigned char data[4];
+  if (fread(data, 4, 1, f)!=1)
+    return 0;
+  *value_out = (((((data[0]<<8) + data[1])<<8) + data[2])<<8) + data[3];
+  return 1;
+}
+
+static int write_uint32(FILE *f, unsigned value) {
+  unsigned char data[4];
+  data[0] = value>>24;
+  data[1] = value>>16;
+  data[2] = value>> 8;
+  data[3] = value>> 0;
+  return fwrite(data, 1, 4, f)==4;
+}
+
+static int read_uint64(FILE *f, uint64_t *value_out) {
+  unsigned hi, lo;
+  if (!read_uint32(f, &hi) || !read_uint32(f, &lo))
+    return 0;
+  *value_out = ((uint64_t) hi << 32) | lo;
+  return 1;
+}
+
+static int write_uint64(FILE *f, uint64_t value) {
+  return write_uint32(f, value >> 32) && write_uint32(f, value);
+}
+
+static int read_string(FILE *f, char **value_out) {
+  unsigned len;
+  if (!read_uint32(f, &len))
+    return 0;
+  *value_out = (char*) malloc(len+1);
+  if (!*value_out)
+    return 0;
+  if (len && fread(*value_out, len, 1, f)!=1)
+    return 0;
+  (*value_out)[len] = 0;
+  return 1;
+}
+
+static int skip_string(FILE *f) {
+  unsigned len;
+  if (!read_uint32(f, &len))
+    return 0;
+  return fseeko(f, len, SEEK_CUR) == 0;
+}
+
+static int write_string(FILE *f, const char *value) {
+  unsigned len = strlen(value);
+  if (!write_uint32(f, len))
+    return 0;
+  if (len && fwrite(value, len, 1, f)!=1)
+    return 0;
+  return 1;
+}
+
+static int check_magic(FILE *f, const char *magic) {
+  char header[KTAR_MAGIC_SIZE];
+  if (fread(header, KTAR_MAGIC_SIZE, 1, f)!=1)
+    return 0;
+  return memcmp(header, magic, KTAR_MAGIC_SIZE) == 0;
+}
+
+/***/
+
+static int kTestArchive_checkHeader(FILE *f) {
+  unsigned version;
+  if (!check_magic(f, KTAR_MAGIC))
+    return 0;
+  if (!read_uint32(f, &version))
+    return 0;
+  return version <= KTAR_VERSION;
+}
+
+int kTestArchive_isArchiveFile(const char *path) {
+  FILE *f = fopen(path, "rb");
+  int res;
+
+  if (!f)
+    return 0;
+  res = kTestArchive_checkHeader(f);
+  fclose(f);
+
+  return res;
+}
+
+static int kTestArchive_readIndex(KTestArchive *a) {
+  uint64_t offset;
+  unsigned i, n;
+  unsigned char tag;
+
+  if (fseeko(a->f, -KTAR_TRAILER_SIZE, SEEK_END))
+    return 0;
+  if (!read_uint64(a->f, &offset) || !check_magic(a->f, KTAR_INDEX_MAGIC))
+    return 0;
+  if (fseeko(a->f, offset, SEEK_SET) || fread(&tag, 1, 1, a->f) != 1 ||
+      tag != KTAR_INDEX)
+    return 0;
+
+  if (!read_uint32(a->f, &n))
+    return 0;
+  a->payloads.resize(n);
+  for (i=0; i<n; i++)
+    if (!read_uint64(a->f, &a->payloads[i]))
+      return 0;
+
+  if (!read_uint32(a->f, &n))
+    return 0;
+  a->tests.resize(n);
+  for (i=0; i<n; i++)
+    if (!read_uint32(a->f, &a->tests[i].first) ||
+        !read_uint64(a->f, &a->tests[i].second))
+      return 0;
+
+  return 1;
+}
+
+/* Rebuild the index of an archive without one, keeping the complete
+   records. */
+static void kTestArchive_scan(KTestArchive *a) {
+  off_t size;
+
+  a->payloads.clear();
+  a->tests.clear();
+  if (fseeko(a->f, 0, SEEK_END) || (size = ftello(a->f)) < 0 ||
+      fseeko(a->f, KTAR_MAGIC_SIZE + 4, SEEK_SET))
+    return;
+
+  for (;;) {
+    off_t offset = ftello(a->f);
+    unsigned char tag;
+    unsigned i, n, id;
+
+    if (fread(&tag, 1, 1, a->f) != 1)
+      return;
+
+    if (tag == KTAR_PAYLOAD) {
+      if (!read_uint32(a->f, &n) || fseeko(a->f, n, SEEK_CUR))
+        return;
+      // fseeko() succeeds past the end of a truncated file.
+      if (ftello(a->f) > size)
+        return;
+      a->payloads.push_back(offset);
+    } else if (tag == KTAR_TEST) {
+      unsigned symArgvs, symArgvLen;
+      if (!read_uint32(a->f, &id) || !read_uint32(a->f, &n))
+        return;
+      for (i=0; i<n; i++)
+        if (!skip_string(a->f))
+          return;
+      if (!read_uint32(a->f, &symArgvs) || !read_uint32(a->f, &symArgvLen) ||
+          !read_uint32(a->f, &n))
+        return;
+      for (i=0; i<n; i++) {
+        unsigned payload;
+        if (!skip_string(a->f) || !read_uint32(a->f, &payload))
+          return;
+      }
+      if (ftello(a->f) > size)
+        return;
+      a->tests.push_back(std::make_pair(id, (uint64_t) offset));
+    } else {
+      return;
+    }
+  }
+}
+
+KTestArchive *kTestArchive_open(const char *path) {
+  FILE *f = fopen(path, "rb");
+  KTestArchive *a;
+
+  if (!f)
+    return 0;
+  if (!kTestArchive_checkHeader(f)) {
+    fclose(f);
+    return 0;
+  }
+
+  a = new KTestArchive();
+  a->f = f;
+  if (!kTestArchive_readIndex(a))
+    kTestArchive_scan(a);
+  return a;
+}
+
+unsigned kTestArchive_numTests(KTestArchive *a) {
+  return a->tests.size();
+}
+
+unsigned kTestArchive_getId(KTestArchive *a, unsigned index) {
+  return a->tests[index].first;
+}
+
+KTest *kTestArchive_getTest(KTestArchive *a, unsigned index) {
+  FILE *f = a->f;
+  KTest *res = 0;
+  unsigned i, id;
+  unsigned char tag;
+
+  if (index >= a->tests.size())
+    return 0;
+  if (fseeko(f, a->tests[index].second, SEEK_SET) ||
+      fread(&tag, 1, 1, f) != 1 || tag != KTAR_TEST)
+    return 0;
+
+  res = (KTest*) calloc(1, sizeof(*res));
+  if (!res)
+    goto error;
+  res->version = kTest_getCurrentVersion();
+
+  if (!read_uint32(f, &id))
+    goto error;
+
+  if (!read_uint32(f, &res->numArgs))
+    goto error;
+  res->args = (char**) calloc(res->numArgs, sizeof(*res->args));
+  if (!res->args)
+    goto error;
+  for (i=0; i<res->numArgs; i++)
+    if (!read_string(f, &res->args[i]))
+      goto error;
+
+  if (!read_uint32(f, &res->symArgvs))
+    goto error;
+  if (!read_uint32(f, &res->symArgvLen))
+    goto error;
+
+  if (!read_uint32(f, &res->numObjects))
+    goto error;
+  res->objects = (KTestObject*) calloc(res->numObjects, sizeof(*res->objects));
+  if (!res->objects)
+    goto error;
+  {
+    std::vector<unsigned> payloadIds(res->numObjects);
+    for (i=0; i<res->numObjects; i++) {
+      if (!read_string(f, &res->objects[i].name))
+        goto error;
+      if (!read_uint32(f, &payloadIds[i]))
+        goto error;
+    }
+    for (i=0; i<res->numObjects; i++) {
+      KTestObject *o = &res->objects[i];
+      if (payloadIds[i] >= a->payloads.size())
+        goto error;
+      if (fseeko(f, a->payloads[payloadIds[i]], SEEK_SET) ||
+          fread(&tag, 1, 1, f) != 1 || tag != KTAR_PAYLOAD)
+        goto error;
+      if (!read_uint32(f, &o->numBytes))
+        goto error;
+      o->bytes = (unsigned char*) malloc(o->numBytes);
+      if (o->numBytes && (!o->bytes || fread(o->bytes, o->numBytes, 1, f)!=1))
+        goto error;
+    }
+  }
+
+  return res;
+ error:
+  if (res) {
+    if (res->args) {
+      for (i=0; i<res->numArgs; i++)
+        free(res->args[i]);
+      free(res->args);
+    }
+    if (res->objects) {
+      for (i=0; i<res->numObjects; i++) {
+        free(res->objects[i].name);
+        free(res->objects[i].bytes);
+      }
+      free(res->objects);
+    }
+    free(res);
+  }
+  return 0;
+}
+
+void kTestArchive_close(KTestArchive *a) {
+  fclose(a->f);
+  delete a;
+}
+
+/***/
+
+static std::string payloadKey(const KTestObject *o) {
+  llvm::MD5 hash;
+  hash.update(llvm::ArrayRef<uint8_t>(o->bytes, o->numBytes));
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> digest;
+  llvm::MD5::stringifyResult(result, digest);
+  return digest.str().str() + ":" + llvm::utostr(o->numBytes);
+}
+
+/* Whether the payload at offset holds the contents of o, leaves the file
+   position unspecified. */
+static int payloadEquals(FILE *f, uint64_t offset, const KTestObject *o) {
+  unsigned char tag, buf[4096];
+  unsigned size, pos, n;
+
+  if (fseeko(f, offset, SEEK_SET) || fread(&tag, 1, 1, f) != 1 ||
+      tag != KTAR_PAYLOAD || !read_uint32(f, &size) || size != o->numBytes)
+    return 0;
+  for (pos=0; pos<size; pos+=n) {
+    n = std::min(size - pos, (unsigned) sizeof(buf));
+    if (fread(buf, n, 1, f) != 1 || memcmp(buf, o->bytes + pos, n))
+      return 0;
+  }
+  return 1;
+}
+
+KTestArchiveWriter *kTestArchive_create(const char *path) {
+  // Opened for reading too, to compare payloads with equal digests.
+  FILE *f = fopen(path, "w+b");
+  KTestArchiveWriter *w;
+
+  if (!f)
+    return 0;
+  if (fwrite(KTAR_MAGIC, KTAR_MAGIC_SIZE, 1, f)!=1 ||
+      !write_uint32(f, KTAR_VERSION) || fflush(f)) {
+    fclose(f);
+    return 0;
+  }
+
+  w = new KTestArchiveWriter();
+  w->f = f;
+  w->failed = false;
+  return w;
+}
+
+int kTestArchive_add(KTestArchiveWriter *w, unsigned id, KTest *bo) {
+  FILE *f = w->f;
+  std::vector<unsigned> payloadIds(bo->numObjects);
+  unsigned i;
+  off_t offset;
+
+  if (w->failed)
+    return 0;
+
+  for (i=0; i<bo->numObjects; i++) {
+    KTestObject *o = &bo->objects[i];
+    std::string key = payloadKey(o);
+    std::unordered_map<std::string, unsigned>::iterator it =
+        w->payloadIds.find(key);
+    if (it != w->payloadIds.end()) {
+      int equal = payloadEquals(f, w->payloads[it->second], o);
+      if (fseeko(f, 0, SEEK_END))
+        goto error;
+      if (equal) {
+        payloadIds[i] = it->second;
+        continue;
+      }
+    }
+
+    offset = ftello(f);
+    if (offset < 0 || fputc(KTAR_PAYLOAD, f) == EOF ||
+        !write_uint32(f, o->numBytes) ||
+        (o->numBytes && fwrite(o->bytes, o->numBytes, 1, f)!=1))
+      goto error;
+    payloadIds[i] = w->payloads.size();
+    w->payloads.push_back(offset);
+    // A colliding payload is written again, the first one stays mapped.
+    w->payloadIds.insert(std::make_pair(key, payloadIds[i]));
+  }
+
+  offset = ftello(f);
+  if (offset < 0 || fputc(KTAR_TEST, f) == EOF || !write_uint32(f, id))
+    goto error;
+  if (!write_uint32(f, bo->numArgs))
+    goto error;
+  for (i=0; i<bo->numArgs; i++)
+    if (!write_string(f, bo->args[i]))
+      goto error;
+  if (!write_uint32(f, bo->symArgvs))
+    goto error;
+  if (!write_uint32(f, bo->symArgvLen))
+    goto error;
+  if (!write_uint32(f, bo->numObjects))
+    goto error;
+  for (i=0; i<bo->numObjects; i++) {
+    if (!write_string(f, bo->objects[i].name))
+      goto error;
+    if (!write_uint32(f, payloadIds[i]))
+      goto error;
+  }
+
+  // Keep the file readable should KLEE not get to finish it.
+  if (fflush(f))
+    goto error;
+
+  w->tests.push_back(std::make_pair(id, (uint64_t) offset));
+  return 1;
+ error:
+  w->failed = true;
+  return 0;
+}
+
+int kTestArchive_finish(KTestArchiveWriter *w) {
+  FILE *f = w->f;
+  int res = 0;
+  off_t offset = ftello(f);
+  unsigned i;
+
+  if (w->failed || offset < 0)
+    goto done;
+  if (fputc(KTAR_INDEX, f) == EOF)
+    goto done;
+  if (!write_uint32(f, w->payloads.size()))
+    goto done;
+  for (i=0; i<w->payloads.size(); i++)
+    if (!write_uint64(f, w->payloads[i]))
+      goto done;
+  if (!write_uint32(f, w->tests.size()))
+    goto done;
+  for (i=0; i<w->tests.size(); i++)
+    if (!write_uint32(f, w->tests[i].first) ||
+        !write_uint64(f, w->tests[i].second))
+      goto done;
+  if (!write_uint64(f, offset) ||
+      fwrite(KTAR_INDEX_MAGIC, KTAR_MAGIC_SIZE, 1, f)!=1)
+    goto done;
+  res = 1;
+ done:
+  if (fclose(f))
+    res = 0;
+  delete w;
+  return res;
+}
@@ -9,6 +9,7 @@
 
 #include "klee/Statistics.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace klee;
@@ -18,7 +19,10 @@ StatisticManager::StatisticManager()
     globalStats(0),
     indexedStats(0),
     contextStats(0),
-    index(0) {
+    index(0),
+    numIndexedColumns(0),
+    indexStride(0),
+    columnStride(0) {
 }
 
 StatisticManager::~StatisticManager() {
@@ -26,16 +30,34 @@ StatisticManager::~StatisticManager() {
   delete[] indexedStats;
 }
 
-void StatisticManager::useIndexedStats(unsigned totalIndices) {  
+void StatisticManager::setIndexed(const Statistic &s) {
+  assert(!indexedStats && "indexed statistics already allocated");
+  if (indexedColumns[s.id] < 0)
+    indexedColumns[s.id] = numIndexedColumns++;
+}
+
+void StatisticManager::useIndexedStats(unsigned totalIndices,
+                                       bool columnMajor) {
   delete[] indexedStats;
-  indexedStats = new uint64_t[totalIndices * stats.size()];
-  memset(indexedStats, 0, sizeof(*indexedStats) * totalIndices * stats.size());
+  if (columnMajor) {
+    indexStride = 1;
+    columnStride = totalIndices;
+  } else {
+    indexStride = numIndexedColumns;
+    columnStride = 1;
+  }
+  // Keep at least one slot so hasIndexedStats() reflects the request
+  // even when no statistic was selected.
+  size_t size = std::max(1u, totalIndices * numIndexedColumns);
+  indexedStats = new uint64_t[size];
+  memset(indexedStats, 0, sizeof(*indexedStats) * size);
 }
 
 void StatisticManager::registerStatistic(Statistic &s) {
   delete[] globalStats;
   s.id = stats.size();
   stats.push_back(&s);
+  indexedColumns.push_back(-1);
   globalStats = new uint64_t[stats.size()];
   memset(globalStats, 0, sizeof(*globalStats)*stats.size());
 }
@@ -27,6 +27,8 @@ void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
 
 void AddressSpace::unbindObject(const MemoryObject *mo) {
   objects = objects.remove(mo);
+  if (symbolicHolders.count(mo))
+    symbolicHolders = symbolicHolders.remove(mo);
 }
 
 const ObjectState *AddressSpace::findObject(const MemoryObject *mo) const {
@@ -49,6 +51,23 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
   }
 }
 
+void AddressSpace::noteSymbolicWrite(const MemoryObject *mo,
+                                     const ObjectState *os) {
+  if (os->hasKnownSymbolics() && !symbolicHolders.count(mo))
+    symbolicHolders = symbolicHolders.insert(mo);
+}
+
+size_t AddressSpace::getOwnedMemoryUsage() const {
+  size_t bytes = 0;
+  for (MemoryMap::iterator it = objects.begin(), ie = objects.end(); 
+       it != ie; ++it) {
+    const ObjectState *os = it->second;
+    if (os->copyOnWriteOwner == cowKey)
+      bytes += os->getMemoryUsage();
+  }
+  return bytes;
+}
+
 /// 
 
 bool AddressSpace::resolveOne(const ref<ConstantExpr> &addr, 
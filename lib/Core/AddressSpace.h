@@ -14,6 +14,7 @@
 
 #include "klee/Expr.h"
 #include "klee/Internal/ADT/ImmutableMap.h"
+#include "klee/Internal/ADT/ImmutableSet.h"
 
 namespace klee {
   class ExecutionState;
@@ -32,6 +33,7 @@ namespace klee {
   };
   
   typedef ImmutableMap<const MemoryObject*, ObjectHolder, MemoryObjectLT> MemoryMap;
+  typedef ImmutableSet<const MemoryObject*, MemoryObjectLT> MemoryObjectSet;
   
   class AddressSpace {
   private:
@@ -50,10 +52,19 @@ namespace klee {
     ///
     /// \invariant forall o in objects, o->copyOnWriteOwner <= cowKey
     MemoryMap objects;
+
+    /// The objects which may hold symbolic bytes written into them, such
+    /// as copies of the contents of symbolic objects. Lets implied value
+    /// concretization find the copies of a read without scanning the
+    /// whole address space. Objects are only added by noteSymbolicWrite,
+    /// so this may still list objects which no longer hold any.
+    MemoryObjectSet symbolicHolders;
     
   public:
     AddressSpace() : cowKey(1) {}
-    AddressSpace(const AddressSpace &b) : cowKey(++b.cowKey), objects(b.objects) { }
+    AddressSpace(const AddressSpace &b)
+      : cowKey(++b.cowKey), objects(b.objects),
+        symbolicHolders(b.symbolicHolders) { }
     ~AddressSpace() {}
 
     /// Resolve address to an ObjectPair in result.
@@ -112,6 +123,15 @@ namespace klee {
     /// \return A writeable ObjectState (\a os or a copy).
     ObjectState *getWriteable(const MemoryObject *mo, const ObjectState *os);
 
+    /// Record that symbolic values may have been written into \a os, the
+    /// binding of \a mo, adding it to symbolicHolders if it now holds any.
+    void noteSymbolicWrite(const MemoryObject *mo, const ObjectState *os);
+
+    /// Return an estimate of the memory (in bytes) held by the
+    /// ObjectStates this address space exclusively owns, i.e. those
+    /// which are not shared copy-on-write with any other address space.
+    size_t getOwnedMemoryUsage() const;
+
     /// Copy the concrete values of all managed ObjectStates into the
     /// actual system memory location they were allocated at.
     void copyOutConcretes();
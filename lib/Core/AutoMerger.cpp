@@ -0,0 +1,371 @@
+//===-- AutoMerger.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "AutoMerger.h"
+
+#include "CoreStats.h"
+#include "Executor.h"
+
+#include "klee/Config/Version.h"
+#include "klee/ExecutionState.h"
+#include "klee/MergeHandler.h"
+#include "klee/Internal/Module/KInstruction.h"
+#include "klee/Internal/Module/KModule.h"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+#include "llvm/Support/CFG.h"
+#else
+#include "llvm/IR/CFG.h"
+#endif
+
+using namespace llvm;
+using namespace klee;
+
+namespace klee {
+  cl::opt<bool>
+  UseAutoMerge("auto-merge",
+               cl::init(false),
+               cl::desc("Merge states automatically at loop heads and at the "
+                        "post-dominators of branches (experimental)"));
+}
+
+namespace {
+  cl::opt<unsigned>
+  AutoMergeMaxWait("auto-merge-max-wait",
+                   cl::init(10000),
+                   cl::desc("Number of instructions other states may execute "
+                            "while a state waits at a merge point "
+                            "(default=10000)"));
+
+  cl::opt<unsigned>
+  AutoMergeMaxQueries("auto-merge-max-queries",
+                      cl::init(64),
+                      cl::desc("Stop merging at a merge point once merged "
+                               "states leaving it issue more solver queries "
+                               "on average before the next merge point "
+                               "(default=64, 0=no limit)"));
+
+  /// The number of samples needed before a merge point is disabled.
+  const uint64_t MinQuerySamples = 4;
+}
+
+/// Compute the immediate post-dominator of every block of \a f with the
+/// algorithm of Cooper, Harvey and Kennedy, run on the reversed control
+/// flow graph with a virtual exit node. Blocks which cannot reach a
+/// return, and blocks only post-dominated by the virtual exit, get none.
+static void computePostDominators(Function *f,
+                                  std::map<BasicBlock*, BasicBlock*> &ipdom) {
+  std::vector<BasicBlock*> blocks;
+  std::map<BasicBlock*, unsigned> index;
+  for (Function::iterator bbit = f->begin(), bbie = f->end();
+       bbit != bbie; ++bbit) {
+    index[&*bbit] = blocks.size();
+    blocks.push_back(&*bbit);
+  }
+  const unsigned exit = blocks.size();
+
+  // In the reversed graph the successors of a block are its predecessors,
+  // and the successors of the virtual exit are the blocks without
+  // successors.
+  std::vector<std::vector<unsigned> > rsuccs(exit + 1), rpreds(exit + 1);
+  for (unsigned i = 0; i != exit; ++i) {
+    BasicBlock *bb = blocks[i];
+    for (pred_iterator it = pred_begin(bb), ie = pred_end(bb); it != ie; ++it)
+      rsuccs[i].push_back(index[*it]);
+    for (succ_iterator it = succ_begin(bb), ie = succ_end(bb); it != ie; ++it)
+      rpreds[i].push_back(index[*it]);
+    if (rpreds[i].empty()) {
+      rsuccs[exit].push_back(i);
+      rpreds[i].push_back(exit);
+    }
+  }
+
+  // Post-order of the reversed graph.
+  std::vector<int> number(exit + 1, -1);
+  std::vector<unsigned> order;
+  std::vector<std::pair<unsigned, unsigned> > stack;
+  std::vector<bool> visited(exit + 1, false);
+  stack.push_back(std::make_pair(exit, 0u));
+  visited[exit] = true;
+  while (!stack.empty()) {
+    unsigned node = stack.back().first;
+    unsigned &next = stack.back().second;
+    if (next < rsuccs[node].size()) {
+      unsigned succ = rsuccs[node][next++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back(std::make_pair(succ, 0u));
+      }
+    } else {
+      number[node] = order.size();
+      order.push_back(node);
+      stack.pop_back();
+    }
+  }
+
+  std::vector<int> idom(exit + 1, -1);
+  idom[exit] = exit;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (std::vector<unsigned>::reverse_iterator it = order.rbegin() + 1,
+           ie = order.rend(); it != ie; ++it) {
+      unsigned node = *it;
+      int newIdom = -1;
+      for (unsigned i = 0; i != rpreds[node].size(); ++i) {
+        int pred = rpreds[node][i];
+        if (idom[pred] == -1)
+          continue;
+        if (newIdom == -1) {
+          newIdom = pred;
+          continue;
+        }
+        int a = pred, b = newIdom;
+        while (a != b) {
+          while (number[a] < number[b])
+            a = idom[a];
+          while (number[b] < number[a])
+            b = idom[b];
+        }
+        newIdom = a;
+      }
+      if (idom[node] != newIdom) {
+        idom[node] = newIdom;
+        changed = true;
+      }
+    }
+  }
+
+  for (unsigned i = 0; i != exit; ++i)
+    if (idom[i] != -1 && idom[i] != (int) exit)
+      ipdom[blocks[i]] = blocks[idom[i]];
+}
+
+/// Find the natural loops of \a f, mapping each loop head to the blocks
+/// of its body.
+static void computeLoops(Function *f,
+                         std::map<BasicBlock*, std::set<BasicBlock*> > &loops) {
+  if (f->empty())
+    return;
+
+  // Depth first search for back edges, i.e. edges to a block on the stack.
+  std::vector<std::pair<BasicBlock*, BasicBlock*> > backEdges;
+  std::set<BasicBlock*> visited, onStack;
+  std::vector<std::pair<BasicBlock*, unsigned> > stack;
+  BasicBlock *entry = &f->getEntryBlock();
+  stack.push_back(std::make_pair(entry, 0u));
+  visited.insert(entry);
+  onStack.insert(entry);
+  while (!stack.empty()) {
+    BasicBlock *bb = stack.back().first;
+    unsigned &next = stack.back().second;
+    auto *ti = bb->getTerminator();
+    if (next < ti->getNumSuccessors()) {
+      BasicBlock *succ = ti->getSuccessor(next++);
+      if (onStack.count(succ)) {
+        backEdges.push_back(std::make_pair(bb, succ));
+      } else if (visited.insert(succ).second) {
+        onStack.insert(succ);
+        stack.push_back(std::make_pair(succ, 0u));
+      }
+    } else {
+      onStack.erase(bb);
+      stack.pop_back();
+    }
+  }
+
+  for (unsigned i = 0; i != backEdges.size(); ++i) {
+    BasicBlock *head = backEdges[i].second;
+    std::set<BasicBlock*> &body = loops[head];
+    body.insert(head);
+    std::vector<BasicBlock*> worklist(1, backEdges[i].first);
+    while (!worklist.empty()) {
+      BasicBlock *bb = worklist.back();
+      worklist.pop_back();
+      if (!body.insert(bb).second)
+        continue;
+      for (pred_iterator it = pred_begin(bb), ie = pred_end(bb); it != ie; ++it)
+        worklist.push_back(*it);
+    }
+  }
+}
+
+AutoMerger::AutoMerger(Executor &_executor)
+  : executor(_executor), numWaiting(0), releaseDeadline(0) {
+  const std::vector<KFunction*> &functions = executor.kmodule->functions;
+  for (std::vector<KFunction*>::const_iterator it = functions.begin(),
+         ie = functions.end(); it != ie; ++it)
+    addMergePoints(*it);
+}
+
+void AutoMerger::addMergePoints(KFunction *kf) {
+  Function *f = kf->function;
+  std::map<BasicBlock*, BasicBlock*> ipdom;
+  std::map<BasicBlock*, std::set<BasicBlock*> > loops;
+  computePostDominators(f, ipdom);
+  computeLoops(f, loops);
+
+  std::set<BasicBlock*> targets;
+  for (std::map<BasicBlock*, std::set<BasicBlock*> >::iterator
+         it = loops.begin(), ie = loops.end(); it != ie; ++it)
+    targets.insert(it->first);
+  for (std::map<BasicBlock*, BasicBlock*>::iterator it = ipdom.begin(),
+         ie = ipdom.end(); it != ie; ++it)
+    if (it->first->getTerminator()->getNumSuccessors() > 1)
+      targets.insert(it->second);
+
+  // States are merged after the phi nodes, which depend on the block
+  // the state came from.
+  std::map<BasicBlock*, MergePoint*> blockPoints;
+  for (std::set<BasicBlock*>::iterator it = targets.begin(),
+         ie = targets.end(); it != ie; ++it) {
+    BasicBlock *bb = *it;
+    unsigned phis = 0;
+    for (BasicBlock::iterator it = bb->begin(); isa<PHINode>(&*it); ++it)
+      ++phis;
+    const KInstruction *ki = kf->instructions[kf->basicBlockEntry[bb] + phis];
+    blockPoints[bb] = &points[ki];
+  }
+
+  for (Function::iterator bbit = f->begin(), bbie = f->end();
+       bbit != bbie; ++bbit) {
+    BasicBlock *bb = &*bbit;
+    if (bb->getTerminator()->getNumSuccessors() < 2)
+      continue;
+    std::vector<MergePoint*> &activated = forkPoints[bb];
+    std::map<BasicBlock*, BasicBlock*>::iterator pd = ipdom.find(bb);
+    if (pd != ipdom.end() && blockPoints.count(pd->second))
+      activated.push_back(blockPoints[pd->second]);
+    for (std::map<BasicBlock*, std::set<BasicBlock*> >::iterator
+           it = loops.begin(), ie = loops.end(); it != ie; ++it)
+      if (it->second.count(bb))
+        activated.push_back(blockPoints[it->first]);
+  }
+}
+
+void AutoMerger::noteFork(const BasicBlock *bb) {
+  std::map<const BasicBlock*, std::vector<MergePoint*> >::iterator it =
+    forkPoints.find(bb);
+  if (it == forkPoints.end())
+    return;
+  for (unsigned i = 0; i != it->second.size(); ++i)
+    it->second[i]->active = true;
+}
+
+void AutoMerger::recordQueries(ExecutionState &state) {
+  std::map<ExecutionState*, MergedState>::iterator it =
+    mergedStates.find(&state);
+  if (it == mergedStates.end())
+    return;
+
+  MergePoint *mp = it->second.point;
+  mp->queries += state.queryCount - it->second.queryCount;
+  ++mp->samples;
+  mergedStates.erase(it);
+
+  if (AutoMergeMaxQueries && !mp->disabled &&
+      mp->samples >= MinQuerySamples &&
+      mp->queries > AutoMergeMaxQueries * mp->samples) {
+    mp->disabled = true;
+    if (DebugLogMerge)
+      llvm::errs() << "auto merge: disabling merge point after "
+                   << mp->merges << " merges (" << mp->queries << " queries in "
+                   << mp->samples << " samples)\n";
+    release(*mp);
+  }
+}
+
+void AutoMerger::release(MergePoint &mp) {
+  for (unsigned i = 0; i != mp.waiting.size(); ++i) {
+    executor.continueState(*mp.waiting[i]);
+    released.insert(mp.waiting[i]);
+  }
+  numWaiting -= mp.waiting.size();
+  mp.waiting.clear();
+}
+
+bool AutoMerger::checkMergePoint(ExecutionState &state) {
+  std::map<const KInstruction*, MergePoint>::iterator it =
+    points.find(state.pc);
+  if (it == points.end())
+    return false;
+  if (released.erase(&state))
+    return false;
+
+  recordQueries(state);
+
+  MergePoint &mp = it->second;
+  if (!mp.active || mp.disabled || !state.openMergeStack.empty())
+    return false;
+
+  for (std::vector<ExecutionState*>::iterator wit = mp.waiting.begin(),
+         wie = mp.waiting.end(); wit != wie; ++wit) {
+    ExecutionState *other = *wit;
+    if (other->merge(state)) {
+      if (DebugLogMerge)
+        llvm::errs() << "auto merge: " << &state << " into " << other << "\n";
+      ++mp.merges;
+      MergedState &ms = mergedStates[other];
+      ms.point = &mp;
+      ms.queryCount = other->queryCount;
+      executor.terminateState(state);
+      return true;
+    }
+  }
+
+  // Do not wait if no other state can arrive.
+  if (executor.states.size() - numWaiting <= 1)
+    return false;
+
+  if (numWaiting == 0)
+    releaseDeadline = stats::instructions + AutoMergeMaxWait;
+  if (mp.waiting.empty())
+    waitingPoints.push_back(&mp);
+  mp.waiting.push_back(&state);
+  ++numWaiting;
+  executor.pauseState(state);
+  return true;
+}
+
+bool AutoMerger::releaseStalled(bool nothingRunnable) {
+  if (numWaiting == 0)
+    return false;
+  if (!nothingRunnable && stats::instructions < releaseDeadline)
+    return false;
+  releaseStates();
+  return true;
+}
+
+void AutoMerger::releaseStates() {
+  for (unsigned i = 0; i != waitingPoints.size(); ++i)
+    release(*waitingPoints[i]);
+  waitingPoints.clear();
+  assert(numWaiting == 0 && "waiting state not at a waiting merge point");
+}
+
+void AutoMerger::removeState(ExecutionState *state) {
+  mergedStates.erase(state);
+  released.erase(state);
+  for (unsigned i = 0; i != waitingPoints.size(); ++i) {
+    std::vector<ExecutionState*> &waiting = waitingPoints[i]->waiting;
+    std::vector<ExecutionState*>::iterator it =
+      std::find(waiting.begin(), waiting.end(), state);
+    if (it != waiting.end()) {
+      waiting.erase(it);
+      --numWaiting;
+      return;
+    }
+  }
+}
@@ -0,0 +1,110 @@
+//===-- AutoMerger.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_AUTOMERGER_H
+#define KLEE_AUTOMERGER_H
+
+#include "llvm/Support/CommandLine.h"
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+namespace llvm {
+  class BasicBlock;
+}
+
+namespace klee {
+  extern llvm::cl::opt<bool> UseAutoMerge;
+
+  class ExecutionState;
+  class Executor;
+  class KFunction;
+  struct KInstruction;
+
+  /// AutoMerger - Merges states without klee_open_merge() and
+  /// klee_close_merge() annotations.
+  ///
+  /// Merge points are the loop heads and the immediate post-dominators
+  /// of branches, taken from the control flow graph of each function. A
+  /// merge point becomes active once one of its branches forks. A state
+  /// reaching an active merge point is merged with a state already
+  /// waiting there, or paused until another state arrives, nothing else
+  /// is left to run, or it has waited for too long.
+  ///
+  /// Merging replaces the differing values by select expressions, which
+  /// can make later queries much harder. Merging is therefore stopped at
+  /// a merge point once the merged states leaving it issue too many
+  /// solver queries before reaching the next merge point.
+  class AutoMerger {
+    struct MergePoint {
+      bool active;
+      bool disabled;
+      std::vector<ExecutionState*> waiting;
+      uint64_t merges;
+      /// Solver queries issued by merged states between leaving this
+      /// merge point and reaching the next one, and the number of such
+      /// samples.
+      uint64_t queries, samples;
+
+      MergePoint()
+        : active(false), disabled(false), merges(0), queries(0), samples(0) {}
+    };
+
+    /// A state which resulted from a merge.
+    struct MergedState {
+      MergePoint *point;
+      uint64_t queryCount;
+    };
+
+    Executor &executor;
+    /// Merge points, keyed by the first non-phi instruction of the block.
+    std::map<const KInstruction*, MergePoint> points;
+    /// The merge points activated by a fork at the end of a block.
+    std::map<const llvm::BasicBlock*, std::vector<MergePoint*> > forkPoints;
+    /// Merge points with waiting states; may include some which no
+    /// longer have any.
+    std::vector<MergePoint*> waitingPoints;
+    std::map<ExecutionState*, MergedState> mergedStates;
+    /// States released from a merge point which may pass it once.
+    std::set<ExecutionState*> released;
+    unsigned numWaiting;
+    /// The instruction count at which waiting states are released.
+    uint64_t releaseDeadline;
+
+    void addMergePoints(KFunction *kf);
+    void recordQueries(ExecutionState &state);
+    void release(MergePoint &mp);
+
+  public:
+    explicit AutoMerger(Executor &_executor);
+
+    /// Note that the branch at the end of \a bb forked.
+    void noteFork(const llvm::BasicBlock *bb);
+
+    /// Called before \a state executes its next instruction. Returns
+    /// true if the state was merged away or paused, and must not run.
+    bool checkMergePoint(ExecutionState &state);
+
+    /// Release waiting states if nothing else is left to run or they
+    /// have waited for too long. Returns true if any state was released.
+    bool releaseStalled(bool nothingRunnable);
+
+    /// Continue all waiting states.
+    void releaseStates();
+
+    /// Forget \a state, which is being terminated.
+    void removeState(ExecutionState *state);
+
+    unsigned getNumWaiting() const { return numWaiting; }
+  };
+}
+
+#endif
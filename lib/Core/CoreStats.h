@@ -30,6 +30,13 @@ namespace stats {
   /// The number of process forks.
   extern Statistic forks;
 
+  /// The number of states terminated for exceeding the memory cap.
+  extern Statistic evictedStates;
+
+  /// Estimated memory (in bytes) reclaimed by terminating states over
+  /// the memory cap.
+  extern Statistic evictedMemory;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
@@ -42,6 +42,7 @@ StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf)
   : caller(_caller), kf(_kf), callPathNode(0), 
     minDistToUncoveredOnReturn(0), varargs(0) {
   locals = new Cell[kf->numRegisters];
+  localsOwner.reset(locals, std::default_delete<Cell[]>());
 }
 
 StackFrame::StackFrame(const StackFrame &s) 
@@ -49,15 +50,18 @@ StackFrame::StackFrame(const StackFrame &s)
     kf(s.kf),
     callPathNode(s.callPathNode),
     allocas(s.allocas),
+    locals(s.locals),
+    localsOwner(s.localsOwner),
     minDistToUncoveredOnReturn(s.minDistToUncoveredOnReturn),
     varargs(s.varargs) {
-  locals = new Cell[s.kf->numRegisters];
-  for (unsigned i=0; i<s.kf->numRegisters; i++)
-    locals[i] = s.locals[i];
 }
 
-StackFrame::~StackFrame() { 
-  delete[] locals; 
+void StackFrame::copyLocals() {
+  Cell *copy = new Cell[kf->numRegisters];
+  for (unsigned i=0; i<kf->numRegisters; i++)
+    copy[i] = locals[i];
+  locals = copy;
+  localsOwner.reset(locals, std::default_delete<Cell[]>());
 }
 
 /***/
@@ -67,6 +71,7 @@ ExecutionState::ExecutionState(KFunction *kf) :
     prevPC(pc),
 
     queryCost(0.), 
+    queryCount(0),
     weight(1),
     depth(0),
 
@@ -78,7 +83,7 @@ ExecutionState::ExecutionState(KFunction *kf) :
 }
 
 ExecutionState::ExecutionState(const std::vector<ref<Expr> > &assumptions)
-    : constraints(assumptions), queryCost(0.), ptreeNode(0) {}
+    : constraints(assumptions), queryCost(0.), queryCount(0), ptreeNode(0) {}
 
 ExecutionState::~ExecutionState() {
   for (unsigned int i=0; i<symbolics.size(); i++)
@@ -102,8 +107,10 @@ ExecutionState::ExecutionState(const ExecutionState& state):
 
     addressSpace(state.addressSpace),
     constraints(state.constraints),
+    pendingConstraint(state.pendingConstraint),
 
     queryCost(state.queryCost),
+    queryCount(state.queryCount),
     weight(state.weight),
     depth(state.depth),
 
@@ -126,9 +133,13 @@ ExecutionState::ExecutionState(const ExecutionState& state):
 ExecutionState *ExecutionState::branch() {
   depth++;
 
+  // The new state starts out with no covered lines, so avoid copying
+  // them in the first place.
+  std::map<const std::string *, std::set<unsigned> > lines;
+  lines.swap(coveredLines);
   ExecutionState *falseState = new ExecutionState(*this);
+  coveredLines.swap(lines);
   falseState->coveredNew = false;
-  falseState->coveredLines.clear();
 
   weight *= .5;
   falseState->weight -= weight;
@@ -152,6 +163,25 @@ void ExecutionState::addSymbolic(const MemoryObject *mo, const Array *array) {
   mo->refCount++;
   symbolics.push_back(std::make_pair(mo, array));
 }
+size_t ExecutionState::getOwnedMemoryUsage() const {
+  size_t bytes = sizeof(*this) + addressSpace.getOwnedMemoryUsage();
+
+  for (stack_ty::const_iterator it = stack.begin(), ie = stack.end();
+       it != ie; ++it) {
+    const StackFrame &sf = *it;
+    bytes += sizeof(sf) + sf.allocas.size() * sizeof(sf.allocas[0]);
+    if (!sf.sharesLocals())
+      bytes += sf.kf->numRegisters * sizeof(*sf.locals);
+  }
+
+  // The constraint expressions themselves are shared with the states
+  // this one was forked from, only the vector is owned.
+  bytes += constraints.size() * sizeof(ref<Expr>);
+  bytes += symbolics.size() * sizeof(symbolics[0]);
+
+  return bytes;
+}
+
 ///
 
 std::string ExecutionState::getFnAlias(std::string fn) {
@@ -307,8 +337,9 @@ bool ExecutionState::merge(const ExecutionState &b) {
   for (; itA!=stack.end(); ++itA, ++itB) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
+    Cell *aLocals = af.getLocalsForWrite();
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
+      ref<Expr> &av = aLocals[i].value;
       const ref<Expr> &bv = bf.locals[i].value;
       if (av.isNull() || bv.isNull()) {
         // if one is null then by implication (we are at same pc)
@@ -334,6 +365,7 @@ bool ExecutionState::merge(const ExecutionState &b) {
       ref<Expr> bv = otherOS->read8(i);
       wos->write(i, SelectExpr::create(inA, av, bv));
     }
+    addressSpace.noteSymbolicWrite(mo, wos);
   }
 
   constraints = ConstraintManager();
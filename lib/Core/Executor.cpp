@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Executor.h"
+#include "AutoMerger.h"
 #include "Context.h"
 #include "CoreStats.h"
 #include "ExternalDispatcher.h"
@@ -15,6 +16,7 @@
 #include "Memory.h"
 #include "MemoryManager.h"
 #include "PTree.h"
+#include "QueryProfiler.h"
 #include "Searcher.h"
 #include "SeedInfo.h"
 #include "SpecialFunctionHandler.h"
@@ -26,10 +28,12 @@
 
 #include "klee/ExecutionState.h"
 #include "klee/Expr.h"
+#include "klee/ExprBuilder.h"
 #include "klee/Interpreter.h"
 #include "klee/TimerStatIncrementer.h"
 #include "klee/CommandLine.h"
 #include "klee/Common.h"
+#include "klee/util/ArraySummary.h"
 #include "klee/util/Assignment.h"
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ExprSMTLIBPrinter.h"
@@ -79,10 +83,12 @@
 #endif
 
 #include <cassert>
+#include <cmath>
 #include <algorithm>
 #include <iomanip>
 #include <iosfwd>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <vector>
 #include <string>
@@ -104,7 +110,42 @@ namespace {
   DumpStatesOnHalt("dump-states-on-halt",
                    cl::init(true),
 		   cl::desc("Dump test cases for all active states on exit (default=on)"));
+
+  cl::opt<double>
+  DumpStatesMaxTime("dump-states-max-time",
+                    cl::init(0),
+                    cl::desc("Stop solving for the remaining states after "
+                             "dumping states for this many seconds; they are "
+                             "terminated without a test case (default=0 (off))"));
   
+  cl::opt<bool>
+  RewriteExprs("rewrite-exprs",
+               cl::init(false),
+               cl::desc("Simplify the expressions built for instructions "
+                        "with the expression rewrite rules; how often each "
+                        "rule applied is written to rewrites.stats "
+                        "(default=off)"));
+
+  cl::opt<bool>
+  QueryProfile("query-profile",
+               cl::init(false),
+               cl::desc("Attribute solver time to the instructions and call "
+                        "paths issuing queries, written to query-sites.prof "
+                        "and query-stacks.folded (default=off)"));
+
+  cl::opt<bool>
+  QueryProfileLog("query-profile-log",
+                  cl::init(false),
+                  cl::desc("With --query-profile, also write one line per "
+                           "query to query-profile.log (default=off)"));
+
+  cl::opt<bool>
+  ShareConstantGlobals("share-constant-globals",
+                       cl::init(true),
+                       cl::desc("Keep constant globals in a single read-only "
+                                "image shared by all states; writing to them "
+                                "is an error (default=on)"));
+
   cl::opt<bool>
   AllowExternalSymCalls("allow-external-sym-calls",
                         cl::init(false),
@@ -151,6 +192,13 @@ namespace {
   cl::opt<bool>
   DebugCheckForImpliedValues("debug-check-for-implied-values");
 
+  cl::opt<bool>
+  ImpliedValueConcretization("implied-value-concretization",
+                             cl::init(true),
+                             cl::desc("Concretize the symbolic bytes an added "
+                                      "constraint fixes in memory, and in "
+                                      "the existing constraints (default=on)"));
+
 
   cl::opt<bool>
   SimplifySymIndices("simplify-sym-indices",
@@ -201,6 +249,14 @@ namespace {
 		  cl::init(false),
                   cl::desc("Discard states that do not have a seed (default=off)."));
  
+  cl::opt<bool>
+  SeedConcolic("seed-concolic",
+               cl::init(false),
+               cl::desc("While all seeds of a state take the same side of a "
+                        "branch, follow them without checking whether the "
+                        "other side is feasible; that is checked once the "
+                        "other side is scheduled (default=off)."));
+
   cl::opt<bool>
   OnlySeed("only-seed",
 	   cl::init(false),
@@ -300,6 +356,23 @@ namespace {
   MaxMemoryInhibit("max-memory-inhibit",
             cl::desc("Inhibit forking at memory cap (vs. random terminate) (default=on)"),
             cl::init(true));
+
+  enum MemoryEvictionType {
+    RandomEviction,
+    MemoryValueEviction
+  };
+
+  cl::opt<MemoryEvictionType>
+  MaxMemoryEviction("max-memory-eviction",
+            cl::desc("Choose which states to terminate when far over the memory cap"),
+            cl::values(
+              clEnumValN(RandomEviction, "random",
+                         "Terminate random states, avoiding states covering new code"),
+              clEnumValN(MemoryValueEviction, "memory-value",
+                         "Terminate states freeing the most owned memory per "
+                         "unit of expected coverage value (default)")
+              KLEE_LLVM_CL_VAL_END),
+            cl::init(MemoryValueEviction));
 }
 
 
@@ -326,11 +399,14 @@ const char *Executor::TerminateReasonNames[] = {
 Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
     InterpreterHandler *ih)
     : Interpreter(opts), kmodule(0), interpreterHandler(ih), searcher(0),
-      externalDispatcher(new ExternalDispatcher(ctx)), statsTracker(0),
+      externalDispatcher(new ExternalDispatcher(ctx)), queryProfiler(0),
+      autoMerger(0), constantGlobalsImage(0), constantGlobalsImageSize(0),
+      statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0),
       processTree(0), replayKTest(0), replayPath(0), usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
-      ivcEnabled(false),
+      ivcEnabled(ImpliedValueConcretization),
+      generationalSearch(userSearcherIsGenerational()),
       coreSolverTimeout(MaxCoreSolverTime != 0 && MaxInstructionTime != 0
                             ? std::min(MaxCoreSolverTime, MaxInstructionTime)
                             : std::max(MaxCoreSolverTime, MaxInstructionTime)),
@@ -347,12 +423,28 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
       interpreterHandler->getOutputFilename(ALL_QUERIES_SMT2_FILE_NAME),
       interpreterHandler->getOutputFilename(SOLVER_QUERIES_SMT2_FILE_NAME),
       interpreterHandler->getOutputFilename(ALL_QUERIES_KQUERY_FILE_NAME),
-      interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME));
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME),
+      interpreterHandler->getOutputFilename(ALL_QUERIES_BINARY_FILE_NAME),
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_BINARY_FILE_NAME));
 
   this->solver = new TimingSolver(solver, EqualitySubstitution);
+  if (QueryProfile) {
+    queryProfiler = new QueryProfiler(interpreterHandler, QueryProfileLog);
+    this->solver->profiler = queryProfiler;
+  }
   memory = new MemoryManager(&arrayCache);
 
+  exprBuilder = createCanonicalExprBuilder();
+  if (RewriteExprs)
+    exprBuilder = createRewritingExprBuilder(exprBuilder);
+  // Every memory access is bounds checked before it is made.
+  ArraySummary::setInBoundsReads(true);
+
   initializeSearchOptions();
+  // Generational search runs each state on an input, without checking
+  // the branches it does not take.
+  if (generationalSearch)
+    SeedConcolic = true;
 
   if (DebugPrintInstructions.isSet(FILE_ALL) ||
       DebugPrintInstructions.isSet(FILE_COMPACT) ||
@@ -415,7 +507,7 @@ const Module *Executor::setModule(llvm::Module *module,
                        userSearcherRequiresMD2U());
   }
   
-  return module;
+  return kmodule->module;
 }
 
 Executor::~Executor() {
@@ -425,12 +517,23 @@ Executor::~Executor() {
   delete specialFunctionHandler;
   delete statsTracker;
   delete solver;
+  delete queryProfiler;
+  if (RewriteExprs) {
+    if (llvm::raw_fd_ostream *os =
+            interpreterHandler->openOutputFile("rewrites.stats")) {
+      printExprRewriteStats(*os);
+      delete os;
+    }
+  }
+  delete exprBuilder;
   delete kmodule;
   while(!timers.empty()) {
     delete timers.back();
     timers.pop_back();
   }
   delete debugInstFile;
+  if (constantGlobalsImage)
+    munmap(constantGlobalsImage, constantGlobalsImageSize);
 }
 
 /***/
@@ -557,6 +660,11 @@ void Executor::initializeGlobals(ExecutionState &state) {
   // allocate and initialize globals, done in two passes since we may
   // need address of a global in order to initialize some other one.
 
+  // Constant globals get their contents from a single image, laid out
+  // once all of them are known.
+  std::vector<std::pair<MemoryObject*, size_t> > imageObjects;
+  size_t imageSize = 0;
+
   // allocate memory objects for all globals
   for (Module::const_global_iterator i = m->global_begin(),
          e = m->global_end();
@@ -625,14 +733,42 @@ void Executor::initializeGlobals(ExecutionState &state) {
                                           /*alignment=*/globalObjectAlignment);
       if (!mo)
         llvm::report_fatal_error("out of memory");
-      ObjectState *os = bindObjectInState(state, mo, false);
       globalObjects.insert(std::make_pair(v, mo));
       globalAddresses.insert(std::make_pair(v, mo->getBaseExpr()));
 
+      if (ShareConstantGlobals && i->isConstant() && i->hasInitializer() &&
+          !i->isExternallyInitialized() && size) {
+        imageSize = (imageSize + 7) & ~(size_t) 7;
+        imageObjects.push_back(std::make_pair(mo, imageSize));
+        imageSize += size;
+        continue;
+      }
+
+      ObjectState *os = bindObjectInState(state, mo, false);
       if (!i->hasInitializer())
           os->initializeToRandom();
     }
   }
+
+  if (!imageObjects.empty()) {
+    if (constantGlobalsImage)
+      munmap(constantGlobalsImage, constantGlobalsImageSize);
+    size_t pageSize = getpagesize();
+    constantGlobalsImageSize = (imageSize + pageSize - 1) & ~(pageSize - 1);
+    void *image = mmap(0, constantGlobalsImageSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (image == MAP_FAILED)
+      klee_error("unable to map image of constant globals: %s",
+                 strerror(errno));
+    constantGlobalsImage = (uint8_t *) image;
+
+    for (unsigned j = 0; j != imageObjects.size(); ++j) {
+      MemoryObject *mo = imageObjects[j].first;
+      ObjectState *os =
+        new ObjectState(mo, constantGlobalsImage + imageObjects[j].second);
+      state.addressSpace.bindObject(mo, os);
+    }
+  }
   
   // link aliases to their definitions (if bound)
   for (Module::alias_iterator i = m->alias_begin(), ie = m->alias_end(); 
@@ -654,9 +790,25 @@ void Executor::initializeGlobals(ExecutionState &state) {
       ObjectState *wos = state.addressSpace.getWriteable(mo, os);
       
       initializeGlobalObject(state, wos, i->getInitializer(), 0);
-      // if(i->isConstant()) os->setReadOnly(true);
     }
   }
+
+  if (!imageObjects.empty()) {
+    for (unsigned j = 0; j != imageObjects.size(); ++j) {
+      MemoryObject *mo = imageObjects[j].first;
+      const ObjectState *os = state.addressSpace.findObject(mo);
+      state.addressSpace.getWriteable(mo, os)->setReadOnly(true);
+      // Read only objects are not copied out before external calls, so
+      // give the native object its contents now.
+      memcpy((void *) (unsigned long) mo->address,
+             constantGlobalsImage + imageObjects[j].second, mo->size);
+    }
+    // Catch any stray write to the image. This is only a safety net, so
+    // carry on without it.
+    if (mprotect(constantGlobalsImage, constantGlobalsImageSize, PROT_READ))
+      klee_warning("unable to make image of constant globals read only: %s",
+                   strerror(errno));
+  }
 }
 
 void Executor::branch(ExecutionState &state, 
@@ -779,16 +931,42 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
     }
   }
 
-  double timeout = coreSolverTimeout;
-  if (isSeeding)
-    timeout *= it->second.size();
-  solver->setTimeout(timeout);
-  bool success = solver->evaluate(current, condition, res);
-  solver->setTimeout(0);
-  if (!success) {
-    current.pc = current.prevPC;
-    terminateStateEarly(current, "Query timed out (fork).");
-    return StatePair(0, 0);
+  // With --seed-concolic, a branch on which all seeds agree is decided by
+  // the seeds, without a query. The other side is forked off with its
+  // condition pending, to be checked when it is scheduled.
+  bool deferFork = false;
+  if (isSeeding && SeedConcolic && !isa<ConstantExpr>(condition)) {
+    bool trueSeed = false, falseSeed = false;
+    for (std::vector<SeedInfo>::iterator siit = it->second.begin(),
+           siie = it->second.end(); siit != siie; ++siit) {
+      ref<Expr> value = siit->assignment.evaluate(condition);
+      ConstantExpr *CE = dyn_cast<ConstantExpr>(value);
+      if (!CE) {
+        trueSeed = falseSeed = true;
+        break;
+      }
+      if (CE->isTrue())
+        trueSeed = true;
+      else
+        falseSeed = true;
+    }
+    deferFork = trueSeed != falseSeed;
+  }
+
+  if (deferFork) {
+    res = Solver::Unknown;
+  } else {
+    double timeout = coreSolverTimeout;
+    if (isSeeding)
+      timeout *= it->second.size();
+    solver->setTimeout(timeout);
+    bool success = solver->evaluate(current, condition, res);
+    solver->setTimeout(0);
+    if (!success) {
+      current.pc = current.prevPC;
+      terminateStateEarly(current, "Query timed out (fork).");
+      return StatePair(0, 0);
+    }
   }
 
   if (!isSeeding) {
@@ -960,8 +1138,19 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       }
     }
 
-    addConstraint(*trueState, condition);
-    addConstraint(*falseState, Expr::createIsZero(condition));
+    if (deferFork) {
+      // Only the side the seeds took is known to be feasible.
+      if (seedMap.count(trueState)) {
+        addConstraint(*trueState, condition);
+        falseState->pendingConstraint = Expr::createIsZero(condition);
+      } else {
+        trueState->pendingConstraint = condition;
+        addConstraint(*falseState, Expr::createIsZero(condition));
+      }
+    } else {
+      addConstraint(*trueState, condition);
+      addConstraint(*falseState, Expr::createIsZero(condition));
+    }
 
     // Kinda gross, do we even really still want this option?
     if (MaxDepth && MaxDepth<=trueState->depth) {
@@ -974,6 +1163,53 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   }
 }
 
+bool Executor::checkPendingConstraint(ExecutionState &state) {
+  ref<Expr> condition = state.pendingConstraint;
+  state.pendingConstraint = 0;
+
+  bool mayBeTrue;
+  solver->setTimeout(coreSolverTimeout);
+  bool success = solver->mayBeTrue(state, condition, mayBeTrue);
+  solver->setTimeout(0);
+  if (!success) {
+    klee_warning_once(0, "query timed out checking a deferred branch, "
+                         "dropping it");
+    mayBeTrue = false;
+  }
+  if (!mayBeTrue) {
+    terminateState(state);
+    return false;
+  }
+
+  addConstraint(state, condition);
+  return true;
+}
+
+void Executor::seedFromSolution(ExecutionState &state) {
+  std::vector<const Array*> objects;
+  for (unsigned i = 0; i != state.symbolics.size(); ++i)
+    objects.push_back(state.symbolics[i].second);
+
+  std::vector< std::vector<unsigned char> > values;
+  if (!objects.empty()) {
+    solver->setTimeout(coreSolverTimeout);
+    bool success = solver->getInitialValues(state, objects, values);
+    solver->setTimeout(0);
+    if (!success) {
+      klee_warning_once(0, "unable to compute an input for a state, "
+                           "running it without one");
+      unseedableStates.insert(&state);
+      return;
+    }
+  }
+
+  // Objects made symbolic later on are extended with zeros.
+  SeedInfo si(0);
+  for (unsigned i = 0; i != objects.size(); ++i)
+    si.assignment.bindings[objects[i]] = values[i];
+  seedMap[&state].push_back(si);
+}
+
 void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(condition)) {
     if (!CE->isTrue())
@@ -1002,10 +1238,12 @@ void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
       klee_warning("seeds patched for violating constraint"); 
   }
 
-  state.addConstraint(condition);
+  // Concretize first, the existing constraints are rewritten with the
+  // values condition implies but condition itself must be kept.
   if (ivcEnabled)
     doImpliedValueConcretization(state, condition, 
                                  ConstantExpr::alloc(1, Expr::Bool));
+  state.addConstraint(condition);
 }
 
 const Cell& Executor::eval(KInstruction *ki, unsigned index, 
@@ -1185,6 +1423,10 @@ void Executor::executeCall(ExecutionState &state,
                            Function *f,
                            std::vector< ref<Expr> > &arguments) {
   Instruction *i = ki->inst;
+  if (f && !f->isDeclaration() &&
+      specialFunctionHandler->handleFastPath(state, f, ki, arguments))
+    return;
+
   if (f && f->isDeclaration()) {
     switch(f->getIntrinsicID()) {
     case Intrinsic::not_intrinsic:
@@ -1341,6 +1583,7 @@ void Executor::executeCall(ExecutionState &state,
             offset += llvm::RoundUpToAlignment(argWidth, WordSize) / 8;
           }
         }
+        state.addressSpace.noteSymbolicWrite(mo, os);
       }
     }
 
@@ -1482,9 +1725,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
             // XXX need to check other param attrs ?
       bool isSExt = cs.paramHasAttr(0, llvm::Attribute::SExt);
             if (isSExt) {
-              result = SExtExpr::create(result, to);
+              result = exprBuilder->SExt(result, to);
             } else {
-              result = ZExtExpr::create(result, to);
+              result = exprBuilder->ZExt(result, to);
             }
           }
 
@@ -1519,6 +1762,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       if (statsTracker && state.stack.back().kf->trackCoverage)
         statsTracker->markBranchVisited(branches.first, branches.second);
 
+      if (autoMerger && branches.first && branches.second)
+        autoMerger->noteFork(bi->getParent());
+
       if (branches.first)
         transferToBasicBlock(bi->getSuccessor(0), bi->getParent(), *branches.first);
       if (branches.second)
@@ -1573,10 +1819,10 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
                it = expressionOrder.begin(),
                itE = expressionOrder.end();
            it != itE; ++it) {
-        ref<Expr> match = EqExpr::create(cond, it->first);
+        ref<Expr> match = exprBuilder->Eq(cond, it->first);
 
         // Make sure that the default value does not contain this target's value
-        defaultValue = AndExpr::create(defaultValue, Expr::createIsZero(match));
+        defaultValue = exprBuilder->And(defaultValue, Expr::createIsZero(match));
 
         // Check if control flow could take this case
         bool result;
@@ -1596,7 +1842,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
               branchTargets.insert(std::make_pair(
                   caseSuccessor, ConstantExpr::alloc(0, Expr::Bool)));
 
-          res.first->second = OrExpr::create(match, res.first->second);
+          res.first->second = exprBuilder->Or(match, res.first->second);
 
           // Only add basic blocks which have not been target of a branch yet
           if (res.second) {
@@ -1629,6 +1875,10 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       }
       std::vector<ExecutionState*> branches;
       branch(state, conditions, branches);
+      if (autoMerger &&
+          branches.size() - std::count(branches.begin(), branches.end(),
+                                       nullptr) > 1)
+        autoMerger->noteFork(bb);
 
       std::vector<ExecutionState*>::iterator bit = branches.begin();
       for (std::vector<BasicBlock *>::iterator it = bbOrder.begin(),
@@ -1699,9 +1949,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
               // XXX need to check other param attrs ?
               bool isSExt = cs.paramHasAttr(i+1, llvm::Attribute::SExt);
               if (isSExt) {
-                arguments[i] = SExtExpr::create(arguments[i], to);
+                arguments[i] = exprBuilder->SExt(arguments[i], to);
               } else {
-                arguments[i] = ZExtExpr::create(arguments[i], to);
+                arguments[i] = exprBuilder->ZExt(arguments[i], to);
               }
             }
           }
@@ -1725,7 +1975,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         bool success = solver->getValue(*free, v, value);
         assert(success && "FIXME: Unhandled solver failure");
         (void) success;
-        StatePair res = fork(*free, EqExpr::create(v, value), true);
+        StatePair res = fork(*free, exprBuilder->Eq(v, value), true);
         if (res.first) {
           uint64_t addr = value->getZExtValue();
           if (legalFunctions.count(addr)) {
@@ -1764,7 +2014,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     ref<Expr> cond = eval(ki, 0, state).value;
     ref<Expr> tExpr = eval(ki, 1, state).value;
     ref<Expr> fExpr = eval(ki, 2, state).value;
-    ref<Expr> result = SelectExpr::create(cond, tExpr, fExpr);
+    ref<Expr> result = exprBuilder->Select(cond, tExpr, fExpr);
     bindLocal(ki, state, result);
     break;
   }
@@ -1778,28 +2028,28 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::Add: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    bindLocal(ki, state, AddExpr::create(left, right));
+    bindLocal(ki, state, exprBuilder->Add(left, right));
     break;
   }
 
   case Instruction::Sub: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    bindLocal(ki, state, SubExpr::create(left, right));
+    bindLocal(ki, state, exprBuilder->Sub(left, right));
     break;
   }
  
   case Instruction::Mul: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    bindLocal(ki, state, MulExpr::create(left, right));
+    bindLocal(ki, state, exprBuilder->Mul(left, right));
     break;
   }
 
   case Instruction::UDiv: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = UDivExpr::create(left, right);
+    ref<Expr> result = exprBuilder->UDiv(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1807,7 +2057,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::SDiv: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = SDivExpr::create(left, right);
+    ref<Expr> result = exprBuilder->SDiv(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1815,7 +2065,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::URem: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = URemExpr::create(left, right);
+    ref<Expr> result = exprBuilder->URem(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1823,7 +2073,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::SRem: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = SRemExpr::create(left, right);
+    ref<Expr> result = exprBuilder->SRem(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1831,7 +2081,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::And: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = AndExpr::create(left, right);
+    ref<Expr> result = exprBuilder->And(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1839,7 +2089,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::Or: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = OrExpr::create(left, right);
+    ref<Expr> result = exprBuilder->Or(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1847,7 +2097,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::Xor: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = XorExpr::create(left, right);
+    ref<Expr> result = exprBuilder->Xor(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1855,7 +2105,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::Shl: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = ShlExpr::create(left, right);
+    ref<Expr> result = exprBuilder->Shl(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1863,7 +2113,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::LShr: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = LShrExpr::create(left, right);
+    ref<Expr> result = exprBuilder->LShr(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1871,7 +2121,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::AShr: {
     ref<Expr> left = eval(ki, 0, state).value;
     ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = AShrExpr::create(left, right);
+    ref<Expr> result = exprBuilder->AShr(left, right);
     bindLocal(ki, state, result);
     break;
   }
@@ -1886,7 +2136,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_EQ: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = EqExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Eq(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1894,7 +2144,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_NE: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = NeExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Ne(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1902,7 +2152,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_UGT: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UgtExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Ugt(left, right);
       bindLocal(ki, state,result);
       break;
     }
@@ -1910,7 +2160,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_UGE: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UgeExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Uge(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1918,7 +2168,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_ULT: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UltExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Ult(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1926,7 +2176,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_ULE: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UleExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Ule(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1934,7 +2184,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_SGT: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SgtExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Sgt(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1942,7 +2192,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_SGE: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SgeExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Sge(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1950,7 +2200,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_SLT: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SltExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Slt(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1958,7 +2208,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     case ICmpInst::ICMP_SLE: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SleExpr::create(left, right);
+      ref<Expr> result = exprBuilder->Sle(left, right);
       bindLocal(ki, state, result);
       break;
     }
@@ -1978,7 +2228,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     if (ai->isArrayAllocation()) {
       ref<Expr> count = eval(ki, 0, state).value;
       count = Expr::createZExtToPointerWidth(count);
-      size = MulExpr::create(size, count);
+      size = exprBuilder->Mul(size, count);
     }
     executeAlloc(state, size, true, ki);
     break;
@@ -2005,13 +2255,13 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
          it != ie; ++it) {
       uint64_t elementSize = it->second;
       ref<Expr> index = eval(ki, it->first, state).value;
-      base = AddExpr::create(base,
-                             MulExpr::create(Expr::createSExtToPointerWidth(index),
-                                             Expr::createPointer(elementSize)));
+      base = exprBuilder->Add(base,
+                              exprBuilder->Mul(Expr::createSExtToPointerWidth(index),
+                                               Expr::createPointer(elementSize)));
     }
     if (kgepi->offset)
-      base = AddExpr::create(base,
-                             Expr::createPointer(kgepi->offset));
+      base = exprBuilder->Add(base,
+                              Expr::createPointer(kgepi->offset));
     bindLocal(ki, state, base);
     break;
   }
@@ -2019,23 +2269,23 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Conversion
   case Instruction::Trunc: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).value,
-                                           0,
-                                           getWidthForLLVMType(ci->getType()));
+    ref<Expr> result = exprBuilder->Extract(eval(ki, 0, state).value,
+                                            0,
+                                            getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
     break;
   }
   case Instruction::ZExt: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = ZExtExpr::create(eval(ki, 0, state).value,
-                                        getWidthForLLVMType(ci->getType()));
+    ref<Expr> result = exprBuilder->ZExt(eval(ki, 0, state).value,
+                                         getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
     break;
   }
   case Instruction::SExt: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = SExtExpr::create(eval(ki, 0, state).value,
-                                        getWidthForLLVMType(ci->getType()));
+    ref<Expr> result = exprBuilder->SExt(eval(ki, 0, state).value,
+                                         getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
     break;
   }
@@ -2044,14 +2294,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width pType = getWidthForLLVMType(ci->getType());
     ref<Expr> arg = eval(ki, 0, state).value;
-    bindLocal(ki, state, ZExtExpr::create(arg, pType));
+    bindLocal(ki, state, exprBuilder->ZExt(arg, pType));
     break;
   }
   case Instruction::PtrToInt: {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width iType = getWidthForLLVMType(ci->getType());
     ref<Expr> arg = eval(ki, 0, state).value;
-    bindLocal(ki, state, ZExtExpr::create(arg, iType));
+    bindLocal(ki, state, exprBuilder->ZExt(arg, iType));
     break;
   }
 
@@ -2338,17 +2588,17 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     unsigned lOffset = kgepi->offset*8, rOffset = kgepi->offset*8 + val->getWidth();
 
     if (lOffset > 0)
-      l = ExtractExpr::create(agg, 0, lOffset);
+      l = exprBuilder->Extract(agg, 0, lOffset);
     if (rOffset < agg->getWidth())
-      r = ExtractExpr::create(agg, rOffset, agg->getWidth() - rOffset);
+      r = exprBuilder->Extract(agg, rOffset, agg->getWidth() - rOffset);
 
     ref<Expr> result;
     if (!l.isNull() && !r.isNull())
-      result = ConcatExpr::create(r, ConcatExpr::create(val, l));
+      result = exprBuilder->Concat(r, exprBuilder->Concat(val, l));
     else if (!l.isNull())
-      result = ConcatExpr::create(val, l);
+      result = exprBuilder->Concat(val, l);
     else if (!r.isNull())
-      result = ConcatExpr::create(r, val);
+      result = exprBuilder->Concat(r, val);
     else
       result = val;
 
@@ -2360,7 +2610,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     ref<Expr> agg = eval(ki, 0, state).value;
 
-    ref<Expr> result = ExtractExpr::create(agg, kgepi->offset*8, getWidthForLLVMType(i->getType()));
+    ref<Expr> result = exprBuilder->Extract(agg, kgepi->offset*8, getWidthForLLVMType(i->getType()));
 
     bindLocal(ki, state, result);
     break;
@@ -2404,7 +2654,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       // rather than right to left.
       unsigned bitOffset = EltBits * (elementCount - i - 1);
       elems.push_back(i == iIdx ? newElt
-                                : ExtractExpr::create(vec, bitOffset, EltBits));
+                                : exprBuilder->Extract(vec, bitOffset, EltBits));
     }
 
     ref<Expr> Result = ConcatExpr::createN(elementCount, elems.data());
@@ -2440,7 +2690,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // that we have to adjust the index so we read left to right
     // rather than right to left.
     unsigned bitOffset = EltBits*(vt->getNumElements() - iIdx -1);
-    ref<Expr> Result = ExtractExpr::create(vec, bitOffset, EltBits);
+    ref<Expr> Result = exprBuilder->Extract(vec, bitOffset, EltBits);
     bindLocal(ki, state, Result);
     break;
   }
@@ -2472,6 +2722,8 @@ void Executor::updateStates(ExecutionState *current) {
                                                ie = removedStates.end();
        it != ie; ++it) {
     ExecutionState *es = *it;
+    if (autoMerger)
+      autoMerger->removeState(es);
     std::set<ExecutionState*>::iterator it2 = states.find(es);
     assert(it2!=states.end());
     states.erase(it2);
@@ -2479,6 +2731,7 @@ void Executor::updateStates(ExecutionState *current) {
       seedMap.find(es);
     if (it3 != seedMap.end())
       seedMap.erase(it3);
+    unseedableStates.erase(es);
     processTree->remove(es->ptreeNode);
     delete es;
   }
@@ -2547,6 +2800,70 @@ void Executor::bindModuleConstants() {
   }
 }
 
+/// Expected coverage value of a state, used to rank victims at the
+/// memory cap. Like the covering-new searcher weight, states close to
+/// uncovered code or which recently covered new code are worth more;
+/// deep states are slightly devalued as their subtrees tend to be
+/// narrower.
+static double getEvictionValue(const ExecutionState &es) {
+  uint64_t md2u = 0;
+  if (theStatisticManager->hasIndexedStats())
+    md2u = computeMinDistToUncovered(es.pc,
+                                     es.stack.back().minDistToUncoveredOnReturn);
+
+  double value = 1. / (md2u ? md2u : 10000);
+  if (es.instsSinceCovNew)
+    value += 1. / std::max(1, (int) es.instsSinceCovNew - 1000);
+  if (es.coveredNew)
+    value += 1.;
+
+  return value / (1. + std::log(1. + es.depth));
+}
+
+void Executor::selectStatesToEvict(unsigned maxToKill, uint64_t bytesToFree,
+                                   std::vector<ExecutionState *> &victims) {
+  std::vector<ExecutionState *> arr(states.begin(), states.end());
+
+  if (MaxMemoryEviction == RandomEviction) {
+    for (unsigned i = 0, N = arr.size(); N && i < maxToKill; ++i, --N) {
+      unsigned idx = rand() % N;
+      // Make two pulls to try and not hit a state that
+      // covered new code.
+      if (arr[idx]->coveredNew)
+        idx = rand() % N;
+
+      std::swap(arr[idx], arr[N - 1]);
+      victims.push_back(arr[N - 1]);
+    }
+    return;
+  }
+
+  // Rank states by the memory they uniquely own per unit of expected
+  // coverage value and terminate from the top until enough has been
+  // reclaimed.
+  typedef std::pair<double, ExecutionState *> RankedState;
+  std::vector<RankedState> ranked;
+  ranked.reserve(arr.size());
+  for (std::vector<ExecutionState *>::iterator it = arr.begin(),
+                                               ie = arr.end();
+       it != ie; ++it) {
+    ExecutionState *es = *it;
+    double bytes = es->getOwnedMemoryUsage();
+    ranked.push_back(std::make_pair(bytes / getEvictionValue(*es), es));
+  }
+  std::sort(ranked.begin(), ranked.end(), std::greater<RankedState>());
+
+  uint64_t freed = 0;
+  for (std::vector<RankedState>::iterator it = ranked.begin(),
+                                          ie = ranked.end();
+       it != ie && victims.size() < maxToKill; ++it) {
+    if (!victims.empty() && freed >= bytesToFree)
+      break;
+    victims.push_back(it->second);
+    freed += it->second->getOwnedMemoryUsage();
+  }
+}
+
 void Executor::checkMemoryUsage() {
   if (!MaxMemory)
     return;
@@ -2562,17 +2879,16 @@ void Executor::checkMemoryUsage() {
         // just guess at how many to kill
         unsigned numStates = states.size();
         unsigned toKill = std::max(1U, numStates - numStates * MaxMemory / mbs);
-        klee_warning("killing %d states (over memory cap)", toKill);
-        std::vector<ExecutionState *> arr(states.begin(), states.end());
-        for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
-          unsigned idx = rand() % N;
-          // Make two pulls to try and not hit a state that
-          // covered new code.
-          if (arr[idx]->coveredNew)
-            idx = rand() % N;
-
-          std::swap(arr[idx], arr[N - 1]);
-          terminateStateEarly(*arr[N - 1], "Memory limit exceeded.");
+        std::vector<ExecutionState *> victims;
+        selectStatesToEvict(toKill, (uint64_t)(mbs - MaxMemory) << 20, victims);
+
+        klee_warning("killing %d states (over memory cap)", (int) victims.size());
+        for (std::vector<ExecutionState *>::iterator it = victims.begin(),
+                                                     ie = victims.end();
+             it != ie; ++it) {
+          ++stats::evictedStates;
+          stats::evictedMemory += (*it)->getOwnedMemoryUsage();
+          terminateStateEarly(**it, "Memory limit exceeded.");
         }
       }
       atMemoryLimit = true;
@@ -2586,13 +2902,58 @@ void Executor::doDumpStates() {
   if (!DumpStatesOnHalt || states.empty())
     return;
   klee_message("halting execution, dumping remaining states");
-  for (std::set<ExecutionState *>::iterator it = states.begin(),
-                                            ie = states.end();
+
+  // Dump the states in the order of the process tree. States next to each
+  // other there share most of their path, and so most of their
+  // constraints, which makes the solver caches far more effective than
+  // the arbitrary order of the states set.
+  std::vector<ExecutionState *> order;
+  order.reserve(states.size());
+  std::vector<PTree::Node *> stack(1, processTree->root);
+  while (!stack.empty()) {
+    PTree::Node *n = stack.back();
+    stack.pop_back();
+    if (n->data && states.count(n->data))
+      order.push_back(n->data);
+    if (n->right)
+      stack.push_back(n->right);
+    if (n->left)
+      stack.push_back(n->left);
+  }
+  if (order.size() != states.size()) {
+    std::set<ExecutionState *> ordered(order.begin(), order.end());
+    for (std::set<ExecutionState *>::iterator it = states.begin(),
+                                              ie = states.end();
+         it != ie; ++it)
+      if (!ordered.count(*it))
+        order.push_back(*it);
+  }
+
+  double deadline =
+      DumpStatesMaxTime ? util::getWallTime() + DumpStatesMaxTime : 0;
+  double savedTimeout = coreSolverTimeout;
+  unsigned skipped = 0;
+  for (std::vector<ExecutionState *>::iterator it = order.begin(),
+                                               ie = order.end();
        it != ie; ++it) {
     ExecutionState &state = **it;
     stepInstruction(state); // keep stats rolling
+    if (deadline) {
+      double left = deadline - util::getWallTime();
+      if (left <= 0) {
+        ++skipped;
+        terminateState(state);
+        continue;
+      }
+      // Bound each query by the time left, where the solver supports it.
+      coreSolverTimeout = savedTimeout ? std::min(savedTimeout, left) : left;
+    }
     terminateStateEarly(state, "Execution halting.");
   }
+  coreSolverTimeout = savedTimeout;
+  if (skipped)
+    klee_warning("dumping states took longer than --dump-states-max-time, "
+                 "%u states terminated without a test case", skipped);
   updateStates(0);
 }
 
@@ -2675,12 +3036,29 @@ void Executor::run(ExecutionState &initialState) {
   }
 
   searcher = constructUserSearcher(*this);
+  if (UseAutoMerge)
+    autoMerger = new AutoMerger(*this);
 
   std::vector<ExecutionState *> newStates(states.begin(), states.end());
   searcher->update(0, newStates, std::vector<ExecutionState *>());
 
   while (!states.empty() && !haltExecution) {
+    if (autoMerger && autoMerger->releaseStalled(searcher->empty()))
+      updateStates(0);
+
     ExecutionState &state = searcher->selectState();
+    if (!state.pendingConstraint.isNull() && !checkPendingConstraint(state)) {
+      updateStates(&state);
+      continue;
+    }
+    if (generationalSearch && SeedConcolic && !seedMap.count(&state) &&
+        !unseedableStates.count(&state))
+      seedFromSolution(state);
+    if (autoMerger && autoMerger->checkMergePoint(state)) {
+      updateStates(&state);
+      continue;
+    }
+
     KInstruction *ki = state.pc;
     stepInstruction(state);
 
@@ -2692,6 +3070,14 @@ void Executor::run(ExecutionState &initialState) {
     updateStates(&state);
   }
 
+  if (autoMerger) {
+    // Waiting states must be back in the searcher before they are dumped.
+    autoMerger->releaseStates();
+    updateStates(0);
+    delete autoMerger;
+    autoMerger = 0;
+  }
+
   delete searcher;
   searcher = 0;
 
@@ -2792,6 +3178,7 @@ void Executor::terminateState(ExecutionState &state) {
       seedMap.find(&state);
     if (it3 != seedMap.end())
       seedMap.erase(it3);
+    unseedableStates.erase(&state);
     addedStates.erase(it);
     processTree->remove(state.ptreeNode);
     delete &state;
@@ -2800,6 +3187,10 @@ void Executor::terminateState(ExecutionState &state) {
 
 void Executor::terminateStateEarly(ExecutionState &state, 
                                    const Twine &message) {
+  // Don't output a test for a path which may not exist.
+  if (!state.pendingConstraint.isNull() && !checkPendingConstraint(state))
+    return;
+
   if (!OnlyOutputStatesCoveringNew || state.coveredNew ||
       (AlwaysOutputSeeds && seedMap.count(&state)))
     interpreterHandler->processTestCase(state, (message + "\n").str().c_str(),
@@ -3090,6 +3481,7 @@ void Executor::executeAlloc(ExecutionState &state,
         unsigned count = std::min(reallocFrom->size, os->size);
         for (unsigned i=0; i<count; i++)
           os->write(i, reallocFrom->read8(i));
+        state.addressSpace.noteSymbolicWrite(mo, os);
         state.addressSpace.unbindObject(reallocFrom->getObject());
       }
     }
@@ -3287,6 +3679,8 @@ void Executor::executeMemoryOperation(ExecutionState &state,
         } else {
           ObjectState *wos = state.addressSpace.getWriteable(mo, os);
           wos->write(offset, value);
+          if (!isa<ConstantExpr>(value))
+            state.addressSpace.noteSymbolicWrite(mo, wos);
         }          
       } else {
         ref<Expr> result = os->read(offset, type);
@@ -3330,6 +3724,8 @@ void Executor::executeMemoryOperation(ExecutionState &state,
         } else {
           ObjectState *wos = bound->addressSpace.getWriteable(mo, os);
           wos->write(mo->getOffsetExpr(address), value);
+          if (!isa<ConstantExpr>(value))
+            bound->addressSpace.noteSymbolicWrite(mo, wos);
         }
       } else {
         ref<Expr> result = os->read(mo->getOffsetExpr(address), type);
@@ -3379,7 +3775,7 @@ void Executor::executeMakeSymbolic(ExecutionState &state,
         KTestObject *obj = si.getNextInput(mo, NamedSeedMatching);
 
         if (!obj) {
-          if (ZeroSeedExtension) {
+          if (ZeroSeedExtension || !si.input) {
             std::vector<unsigned char> &values = si.assignment.bindings[array];
             values = std::vector<unsigned char>(mo->size, '\0');
           } else if (!AllowSeedExtension) {
@@ -3536,6 +3932,8 @@ void Executor::runFunctionAsMain(Function *f,
 
   if (statsTracker)
     statsTracker->done();
+  if (queryProfiler)
+    queryProfiler->dump();
 }
 
 unsigned Executor::getPathStreamID(const ExecutionState &state) {
@@ -3645,35 +4043,79 @@ void Executor::getCoveredLines(const ExecutionState &state,
 void Executor::doImpliedValueConcretization(ExecutionState &state,
                                             ref<Expr> e,
                                             ref<ConstantExpr> value) {
-  abort(); // FIXME: Broken until we sort out how to do the write back.
-
   if (DebugCheckForImpliedValues)
     ImpliedValue::checkForImpliedValues(solver->solver, e, value);
 
   ImpliedValueList results;
   ImpliedValue::getImpliedValues(e, value, results);
+  if (results.empty())
+    return;
+
+  std::map< ref<Expr>, ref<Expr> > equalities;
+  ObjectState::FixedReadMap fixedBytes;
   for (ImpliedValueList::iterator it = results.begin(), ie = results.end();
        it != ie; ++it) {
     ReadExpr *re = it->first.get();
-    
-    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
-      // FIXME: This is the sole remaining usage of the Array object
-      // variable. Kill me.
-      const MemoryObject *mo = 0; //re->updates.root->object;
-      const ObjectState *os = state.addressSpace.findObject(mo);
+    equalities.insert(std::make_pair(re, it->second));
+
+    // Only bytes of the initial contents of symbolic arrays can be held by
+    // objects, a read through updates is of a value which no longer exists.
+    ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index);
+    if (CE && !re->updates.head && re->updates.root->isSymbolicArray() &&
+        it->second->getWidth() == Expr::Int8)
+      fixedBytes.insert(std::make_pair(
+          std::make_pair(re->updates.root, (unsigned) CE->getZExtValue(32)),
+          (uint8_t) it->second->getZExtValue(8)));
+  }
 
-      if (!os) {
-        // object has been free'd, no need to concretize (although as
-        // in other cases we would like to concretize the outstanding
-        // reads, but we have no facility for that yet)
-      } else {
-        assert(!os->readOnly && 
-               "not possible? read only object with static read?");
-        ObjectState *wos = state.addressSpace.getWriteable(mo, os);
-        wos->write(CE, it->second);
-      }
+  // Write the values back into every object still holding the reads, so
+  // that they are executed concretely from now on. Only the symbolic
+  // objects of the arrays and the objects known to hold symbolic bytes
+  // can hold them. Objects are collected first as making them writeable
+  // changes the address space.
+  if (!fixedBytes.empty()) {
+    std::set<const MemoryObject*> candidates;
+    for (unsigned i = 0; i != state.symbolics.size(); ++i) {
+      ObjectState::FixedReadMap::iterator it = fixedBytes.lower_bound(
+          std::make_pair(state.symbolics[i].second, 0u));
+      if (it != fixedBytes.end() &&
+          it->first.first == state.symbolics[i].second)
+        candidates.insert(state.symbolics[i].first);
+    }
+    const MemoryObjectSet &holders = state.addressSpace.symbolicHolders;
+    for (MemoryObjectSet::iterator it = holders.begin(), ie = holders.end();
+         it != ie; ++it)
+      candidates.insert(*it);
+
+    std::vector<std::pair<const MemoryObject*, const ObjectState*> > objects;
+    std::vector<std::vector<std::pair<unsigned, uint8_t> > > bytes;
+    for (std::set<const MemoryObject*>::iterator it = candidates.begin(),
+           ie = candidates.end(); it != ie; ++it) {
+      const ObjectState *os = state.addressSpace.findObject(*it);
+      if (!os || os->readOnly)
+        continue;
+      if (!os->hasKnownSymbolics() &&
+          state.addressSpace.symbolicHolders.count(*it))
+        state.addressSpace.symbolicHolders =
+            state.addressSpace.symbolicHolders.remove(*it);
+      std::vector<std::pair<unsigned, uint8_t> > found;
+      os->findFixedBytes(fixedBytes, found);
+      if (found.empty())
+        continue;
+      objects.push_back(std::make_pair(*it, os));
+      bytes.push_back(found);
+    }
+
+    for (unsigned i = 0, e = objects.size(); i != e; ++i) {
+      ObjectState *wos =
+          state.addressSpace.getWriteable(objects[i].first, objects[i].second);
+      for (std::vector<std::pair<unsigned, uint8_t> >::iterator
+             it = bytes[i].begin(), ie = bytes[i].end(); it != ie; ++it)
+        wos->write8(it->first, it->second);
     }
   }
+
+  state.constraints.rewriteEqualities(equalities);
 }
 
 Expr::Width Executor::getWidthForLLVMType(llvm::Type *type) const {
@@ -3752,6 +4194,8 @@ void Executor::prepareForEarlyExit() {
     // Make sure stats get flushed out
     statsTracker->done();
   }
+  if (queryProfiler)
+    queryProfiler->dump();
 }
 ///
 
@@ -51,6 +51,7 @@ namespace klee {
   class Array;
   struct Cell;
   class ExecutionState;
+  class ExprBuilder;
   class ExternalDispatcher;
   class Expr;
   class InstructionInfoTable;
@@ -62,6 +63,7 @@ namespace klee {
   class MemoryObject;
   class ObjectState;
   class PTree;
+  class QueryProfiler;
   class Searcher;
   class SeedInfo;
   class SpecialFunctionHandler;
@@ -70,6 +72,7 @@ namespace klee {
   class TimingSolver;
   class TreeStreamWriter;
   class MergeHandler;
+  class AutoMerger;
   template<class T> class ref;
 
 
@@ -80,11 +83,13 @@ namespace klee {
 
 class Executor : public Interpreter {
   friend class RandomPathSearcher;
+  friend class GenerationalSearcher;
   friend class OwningSearcher;
   friend class WeightedRandomSearcher;
   friend class SpecialFunctionHandler;
   friend class StatsTracker;
   friend class MergeHandler;
+  friend class AutoMerger;
 
 public:
   class Timer {
@@ -125,6 +130,13 @@ private:
 
   ExternalDispatcher *externalDispatcher;
   TimingSolver *solver;
+  QueryProfiler *queryProfiler;
+  /// Builds the expressions for the results of instructions, rewriting
+  /// them with --rewrite-exprs
+  ExprBuilder *exprBuilder;
+  /// Merges states at automatically chosen merge points, if enabled
+  /// with --auto-merge.
+  AutoMerger *autoMerger;
   MemoryManager *memory;
   std::set<ExecutionState*> states;
   StatsTracker *statsTracker;
@@ -159,10 +171,19 @@ private:
   /// happens with other states (that don't satisfy the seeds) depends
   /// on as-yet-to-be-determined flags.
   std::map<ExecutionState*, std::vector<SeedInfo> > seedMap;
+
+  /// The states for which seedFromSolution failed to compute an input.
+  /// They run without one rather than retrying at every step.
+  std::set<ExecutionState*> unseedableStates;
   
   /// Map of globals to their representative memory object.
   std::map<const llvm::GlobalValue*, MemoryObject*> globalObjects;
 
+  /// The contents of the constant globals, shared by all states and
+  /// made read only once initialized.
+  uint8_t *constantGlobalsImage;
+  size_t constantGlobalsImageSize;
+
   /// Map of globals to their bound address. This also includes
   /// globals that have no representative object (i.e. functions).
   std::map<const llvm::GlobalValue*, ref<ConstantExpr> > globalAddresses;
@@ -195,10 +216,15 @@ private:
   /// step.
   bool haltExecution;  
 
-  /// Whether implied-value concretization is enabled. Currently
-  /// false, it is buggy (it needs to validate its writes).
+  /// Whether implied-value concretization is enabled, i.e. whether the
+  /// values an added constraint fixes are written back into memory and
+  /// the existing constraints.
   bool ivcEnabled;
 
+  /// Whether the generational searcher is used, in which case each state
+  /// is given an input when it is first selected (see seedFromSolution).
+  bool generationalSearch;
+
   /// The maximum time to allow for a single core solver query.
   /// (e.g. for a single STP query)
   double coreSolverTimeout;
@@ -330,6 +356,15 @@ private:
   /// validity checks, and seed patching.
   void addConstraint(ExecutionState &state, ref<Expr> condition);
 
+  /// Check whether the pending constraint of a state forked off while
+  /// following seeds (see --seed-concolic) may hold, and add it. Returns
+  /// false if it does not, in which case the state was terminated.
+  bool checkPendingConstraint(ExecutionState &state);
+
+  /// Seed a state with a solution to its constraints, so that it runs on
+  /// a concrete input (see --search=generational).
+  void seedFromSolution(ExecutionState &state);
+
   // Called on [for now] concrete reads, replaces constant with a symbolic
   // Used for testing.
   ref<Expr> replaceReadWithSymbolic(ExecutionState &state, ref<Expr> e);
@@ -340,12 +375,12 @@ private:
   Cell& getArgumentCell(ExecutionState &state,
                         KFunction *kf,
                         unsigned index) {
-    return state.stack.back().locals[kf->getArgRegister(index)];
+    return state.stack.back().getLocalsForWrite()[kf->getArgRegister(index)];
   }
 
   Cell& getDestCell(ExecutionState &state,
                     KInstruction *target) {
-    return state.stack.back().locals[target->dest];
+    return state.stack.back().getLocalsForWrite()[target->dest];
   }
 
   void bindLocal(KInstruction *target, 
@@ -435,6 +470,9 @@ private:
                          KInstruction *target, 
                          const std::vector<ref<Expr> > &arguments);
 
+  /// Concretize the reads of symbolic bytes which e having the given
+  /// value fixes, both in the objects of state holding them and in its
+  /// existing constraints.
   void doImpliedValueConcretization(ExecutionState &state,
                                     ref<Expr> e,
                                     ref<ConstantExpr> value);
@@ -449,6 +487,11 @@ private:
   void processTimers(ExecutionState *current,
                      double maxInstTime);
   void checkMemoryUsage();
+
+  /// Choose at most \a maxToKill states to terminate in order to get
+  /// back under the memory cap, aiming to reclaim \a bytesToFree bytes.
+  void selectStatesToEvict(unsigned maxToKill, uint64_t bytesToFree,
+                           std::vector<ExecutionState *> &victims);
   void printDebugInstructions(ExecutionState &state);
   void doDumpStates();
 
@@ -143,8 +143,8 @@ void ImpliedValue::getImpliedValues(ref<Expr> e,
   case Expr::Or: {
     BinaryExpr *be = cast<BinaryExpr>(e);
     if (value->isZero()) {
-      getImpliedValues(be->left, 0, results);
-      getImpliedValues(be->right, 0, results);
+      getImpliedValues(be->left, value, results);
+      getImpliedValues(be->right, value, results);
     } else {
       // FIXME: Can do more?
     }
@@ -26,6 +26,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 
@@ -36,6 +37,14 @@ namespace {
   cl::opt<bool>
   UseConstantArrays("use-constant-arrays",
                     cl::init(true));
+
+  cl::opt<unsigned>
+  UpdateListCompactionThreshold("update-list-compaction-threshold",
+                                cl::init(1024),
+                                cl::desc("Try to shorten the update list of "
+                                         "an object once it reaches this "
+                                         "many writes, 0 to disable "
+                                         "(default=1024)"));
 }
 
 /***/
@@ -97,10 +106,12 @@ ObjectState::ObjectState(const MemoryObject *mo)
     refCount(0),
     object(mo),
     concreteStore(new uint8_t[mo->size]),
+    ownsConcreteStore(true),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
     updates(0, 0),
+    nextCompaction(UpdateListCompactionThreshold),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
@@ -119,10 +130,12 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
     refCount(0),
     object(mo),
     concreteStore(new uint8_t[mo->size]),
+    ownsConcreteStore(true),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
     updates(array, 0),
+    nextCompaction(UpdateListCompactionThreshold),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
@@ -130,15 +143,40 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   memset(concreteStore, 0, size);
 }
 
+ObjectState::ObjectState(const MemoryObject *mo, uint8_t *store)
+  : copyOnWriteOwner(0),
+    refCount(0),
+    object(mo),
+    concreteStore(store),
+    ownsConcreteStore(false),
+    concreteMask(0),
+    flushMask(0),
+    knownSymbolics(0),
+    updates(0, 0),
+    nextCompaction(UpdateListCompactionThreshold),
+    size(mo->size),
+    readOnly(false) {
+  mo->refCount++;
+  if (!UseConstantArrays) {
+    static unsigned id = 0;
+    const Array *array =
+        getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
+    updates = UpdateList(array, 0);
+  }
+  memset(concreteStore, 0, size);
+}
+
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     refCount(0),
     object(os.object),
     concreteStore(new uint8_t[os.size]),
+    ownsConcreteStore(true),
     concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
     flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
     knownSymbolics(0),
     updates(os.updates),
+    nextCompaction(os.nextCompaction),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
@@ -158,7 +196,8 @@ ObjectState::~ObjectState() {
   delete concreteMask;
   delete flushMask;
   delete[] knownSymbolics;
-  delete[] concreteStore;
+  if (ownsConcreteStore)
+    delete[] concreteStore;
 
   if (object)
   {
@@ -171,6 +210,21 @@ ObjectState::~ObjectState() {
   }
 }
 
+size_t ObjectState::getMemoryUsage() const {
+  // BitArrays are stored as 32-bit words.
+  size_t maskBytes = ((size + 31) / 32) * sizeof(uint32_t);
+  size_t bytes = sizeof(*this);
+  if (ownsConcreteStore)
+    bytes += size * sizeof(*concreteStore);
+  if (concreteMask)
+    bytes += maskBytes;
+  if (flushMask)
+    bytes += maskBytes;
+  if (knownSymbolics)
+    bytes += size * sizeof(*knownSymbolics);
+  return bytes;
+}
+
 ArrayCache *ObjectState::getArrayCache() const {
   assert(object && "object was NULL");
   return object->parent->getArrayCache();
@@ -215,11 +269,7 @@ const UpdateList &ObjectState::getUpdates() const {
       Contents[Index->getZExtValue()] = Value;
     }
 
-    static unsigned id = 0;
-    const Array *array = getArrayCache()->CreateArray(
-        "const_arr" + llvm::utostr(++id), size, &Contents[0],
-        &Contents[0] + Contents.size());
-    updates = UpdateList(array, 0);
+    updates = UpdateList(createConstantArray(Contents), 0);
 
     // Apply the remaining (non-constant) writes.
     for (; Begin != End; ++Begin)
@@ -229,6 +279,88 @@ const UpdateList &ObjectState::getUpdates() const {
   return updates;
 }
 
+const Array *ObjectState::createConstantArray(
+    const std::vector<ref<ConstantExpr> > &contents) const {
+  static unsigned id = 0;
+  return getArrayCache()->CreateArray("const_arr" + llvm::utostr(++id),
+                                      contents.size(), &contents[0],
+                                      &contents[0] + contents.size());
+}
+
+/// Shorten long update lists. Reads carry the whole list, so its length
+/// is paid for on every read expression built from it, in every solver
+/// translation and in every evaluation.
+///
+/// If the current value of every byte is known, the history is irrelevant
+/// and the list is rebased onto a fresh constant array holding the
+/// concrete bytes, followed by one write per known symbolic byte.
+/// Otherwise, the oldest run of concrete writes on top of a constant
+/// array is folded into a new constant array.
+///
+/// An attempt costs time linear in the size of the object and the length
+/// of the list, and a rebase also allocates a new array which is never
+/// freed. The next attempt is therefore only made once the list reaches
+/// twice its length and at least the size of the object, so that each
+/// attempt is paid for by at least half as many writes as it inspects.
+void ObjectState::compactUpdates() const {
+  unsigned numUpdates = updates.getSize();
+  if (!UpdateListCompactionThreshold || numUpdates < nextCompaction ||
+      !UseConstantArrays || !size)
+    return;
+
+  bool allKnown = true;
+  for (unsigned i = 0; i != size && allKnown; ++i)
+    allKnown = isByteConcrete(i) || isByteKnownSymbolic(i);
+
+  if (allKnown) {
+    std::vector< ref<ConstantExpr> > contents(size);
+    for (unsigned i = 0; i != size; ++i)
+      contents[i] = ConstantExpr::create(isByteConcrete(i) ? concreteStore[i]
+                                                           : 0,
+                                         Expr::Int8);
+
+    updates = UpdateList(createConstantArray(contents), 0);
+    for (unsigned i = 0; i != size; ++i)
+      if (isByteKnownSymbolic(i))
+        updates.extend(ConstantExpr::create(i, Expr::Int32),
+                       knownSymbolics[i]);
+
+    // Everything is now reflected in the update list.
+    delete flushMask;
+    flushMask = new BitArray(size, false);
+  } else if (updates.root && updates.root->isConstantArray()) {
+    std::vector<const UpdateNode*> nodes(numUpdates);
+    const UpdateNode *un = updates.head;
+    for (unsigned i = numUpdates; i != 0; un = un->next)
+      nodes[--i] = un;
+
+    unsigned folded = 0;
+    for (; folded != numUpdates; ++folded) {
+      if (!isa<ConstantExpr>(nodes[folded]->index) ||
+          !isa<ConstantExpr>(nodes[folded]->value))
+        break;
+    }
+
+    if (folded) {
+      std::vector< ref<ConstantExpr> > contents(
+          updates.root->constantValues);
+      for (unsigned i = 0; i != folded; ++i) {
+        uint64_t index = cast<ConstantExpr>(nodes[i]->index)->getZExtValue();
+        if (index < size)
+          contents[index] = cast<ConstantExpr>(nodes[i]->value);
+      }
+
+      UpdateList compacted(createConstantArray(contents), 0);
+      for (unsigned i = folded; i != numUpdates; ++i)
+        compacted.extend(nodes[i]->index, nodes[i]->value);
+      updates = compacted;
+    }
+  }
+
+  nextCompaction = std::max((unsigned) UpdateListCompactionThreshold,
+                            std::max(size, 2 * updates.getSize()));
+}
+
 void ObjectState::makeConcrete() {
   delete concreteMask;
   delete flushMask;
@@ -280,6 +412,17 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
+  // Read only objects are entirely concrete and never change, so a
+  // single constant array serves all symbolic reads of them.
+  if (readOnly && !flushMask && UseConstantArrays && !updates.head) {
+    std::vector< ref<ConstantExpr> > contents(size);
+    for (unsigned i = 0; i != size; ++i)
+      contents[i] = ConstantExpr::create(concreteStore[i], Expr::Int8);
+    updates = UpdateList(createConstantArray(contents), 0);
+    flushMask = new BitArray(size, false);
+    return;
+  }
+
   if (!flushMask) flushMask = new BitArray(size, true);
  
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
@@ -328,6 +471,10 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
   } 
 }
 
+bool ObjectState::isRangeConcrete(unsigned offset, unsigned count) const {
+  return !concreteMask || concreteMask->isAllSet(offset, count);
+}
+
 bool ObjectState::isByteConcrete(unsigned offset) const {
   return !concreteMask || concreteMask->get(offset);
 }
@@ -340,6 +487,16 @@ bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
   return knownSymbolics && knownSymbolics[offset].get();
 }
 
+void ObjectState::markRangeConcrete(unsigned offset, unsigned count) {
+  if (knownSymbolics)
+    for (unsigned i = 0; i != count; ++i)
+      setKnownSymbolic(offset + i, 0);
+  if (concreteMask)
+    concreteMask->setRange(offset, count);
+  if (flushMask)
+    flushMask->setRange(offset, count);
+}
+
 void ObjectState::markByteConcrete(unsigned offset) {
   if (concreteMask)
     concreteMask->set(offset);
@@ -395,6 +552,7 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
   assert(!isa<ConstantExpr>(offset) && "constant offset passed to symbolic read8");
   unsigned base, size;
   fastRangeCheckOffset(offset, &base, &size);
+  compactUpdates();
   flushRangeForRead(base, size);
 
   if (size>4096) {
@@ -433,6 +591,7 @@ void ObjectState::write8(ref<Expr> offset, ref<Expr> value) {
   assert(!isa<ConstantExpr>(offset) && "constant offset passed to symbolic write8");
   unsigned base, size;
   fastRangeCheckOffset(offset, &base, &size);
+  compactUpdates();
   flushRangeForWrite(base, size);
 
   if (size>4096) {
@@ -480,9 +639,15 @@ ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
   if (width == Expr::Bool)
     return ExtractExpr::create(read8(offset), 0, Expr::Bool);
 
-  // Otherwise, follow the slow general case.
   unsigned NumBytes = width / 8;
   assert(width == NumBytes * 8 && "Invalid width for read size!");
+
+  // Concrete ranges, such as everything in the constant globals, are read
+  // straight from the concrete store.
+  if (isRangeConcrete(offset, NumBytes))
+    return readConcrete(offset, width);
+
+  // Otherwise, follow the slow general case.
   ref<Expr> Res(0);
   for (unsigned i = 0; i != NumBytes; ++i) {
     unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
@@ -493,6 +658,27 @@ ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
   return Res;
 }
 
+ref<ConstantExpr> ObjectState::readConcrete(unsigned offset,
+                                            Expr::Width width) const {
+  unsigned NumBytes = width / 8;
+  bool isLittleEndian = Context::get().isLittleEndian();
+  if (width <= Expr::Int64) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i != NumBytes; ++i) {
+      unsigned idx = isLittleEndian ? i : (NumBytes - i - 1);
+      value |= (uint64_t) concreteStore[offset + idx] << (8 * i);
+    }
+    return ConstantExpr::create(value, width);
+  }
+
+  std::vector<uint64_t> words((NumBytes + 7) / 8);
+  for (unsigned i = 0; i != NumBytes; ++i) {
+    unsigned idx = isLittleEndian ? i : (NumBytes - i - 1);
+    words[i / 8] |= (uint64_t) concreteStore[offset + idx] << (8 * (i % 8));
+  }
+  return ConstantExpr::alloc(llvm::APInt(width, words));
+}
+
 void ObjectState::write(ref<Expr> offset, ref<Expr> value) {
   // Truncate offset to 32-bits.
   offset = ZExtExpr::create(offset, Expr::Int32);
@@ -523,18 +709,11 @@ void ObjectState::write(ref<Expr> offset, ref<Expr> value) {
 void ObjectState::write(unsigned offset, ref<Expr> value) {
   // Check for writes of constant values.
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value)) {
-    Expr::Width w = CE->getWidth();
-    if (w <= 64 && klee::bits64::isPowerOfTwo(w)) {
-      uint64_t val = CE->getZExtValue();
-      switch (w) {
-      default: assert(0 && "Invalid write size!");
-      case  Expr::Bool:
-      case  Expr::Int8:  write8(offset, val); return;
-      case Expr::Int16: write16(offset, val); return;
-      case Expr::Int32: write32(offset, val); return;
-      case Expr::Int64: write64(offset, val); return;
-      }
-    }
+    if (CE->getWidth() == Expr::Bool)
+      write8(offset, (uint8_t) CE->getZExtValue(1));
+    else
+      writeConcrete(offset, CE->getAPValue());
+    return;
   }
 
   // Treat bool specially, it is the only non-byte sized write we allow.
@@ -553,27 +732,101 @@ void ObjectState::write(unsigned offset, ref<Expr> value) {
   }
 } 
 
-void ObjectState::write16(unsigned offset, uint16_t value) {
-  unsigned NumBytes = 2;
+/// Store the bytes of value in target order and update the masks for the
+/// whole range at once.
+void ObjectState::writeConcrete(unsigned offset, const llvm::APInt &value) {
+  unsigned NumBytes = value.getBitWidth() / 8;
+  assert(value.getBitWidth() == NumBytes * 8 && "Invalid write size!");
+  const uint64_t *words = value.getRawData();
+  bool isLittleEndian = Context::get().isLittleEndian();
   for (unsigned i = 0; i != NumBytes; ++i) {
-    unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
-    write8(offset + idx, (uint8_t) (value >> (8 * i)));
+    unsigned idx = isLittleEndian ? i : (NumBytes - i - 1);
+    concreteStore[offset + idx] = (uint8_t) (words[i / 8] >> (8 * (i % 8)));
   }
+  markRangeConcrete(offset, NumBytes);
+}
+
+void ObjectState::write16(unsigned offset, uint16_t value) {
+  writeConcrete(offset, llvm::APInt(16, value));
 }
 
 void ObjectState::write32(unsigned offset, uint32_t value) {
-  unsigned NumBytes = 4;
-  for (unsigned i = 0; i != NumBytes; ++i) {
-    unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
-    write8(offset + idx, (uint8_t) (value >> (8 * i)));
-  }
+  writeConcrete(offset, llvm::APInt(32, value));
 }
 
 void ObjectState::write64(unsigned offset, uint64_t value) {
-  unsigned NumBytes = 8;
-  for (unsigned i = 0; i != NumBytes; ++i) {
-    unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
-    write8(offset + idx, (uint8_t) (value >> (8 * i)));
+  writeConcrete(offset, llvm::APInt(64, value));
+}
+
+void ObjectState::copyFrom(unsigned offset, const ObjectState &src,
+                           unsigned srcOffset, unsigned count) {
+  assert(offset + count <= size && srcOffset + count <= src.size &&
+         "out of bounds copy");
+
+  if (src.isRangeConcrete(srcOffset, count)) {
+    memmove(concreteStore + offset, src.concreteStore + srcOffset, count);
+    markRangeConcrete(offset, count);
+    return;
+  }
+
+  // Mixed range, go through a temporary in case the ranges overlap.
+  std::vector<ref<Expr> > bytes(count);
+  for (unsigned i = 0; i != count; ++i)
+    bytes[i] = src.read8(srcOffset + i);
+  for (unsigned i = 0; i != count; ++i)
+    write8(offset + i, bytes[i]);
+}
+
+void ObjectState::fill(unsigned offset, ref<Expr> value, unsigned count) {
+  assert(offset + count <= size && "out of bounds fill");
+  assert(value->getWidth() == Expr::Int8 && "fill value must be a byte");
+
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value)) {
+    memset(concreteStore + offset, (uint8_t) CE->getZExtValue(8), count);
+    markRangeConcrete(offset, count);
+    return;
+  }
+
+  for (unsigned i = 0; i != count; ++i)
+    write8(offset + i, value);
+}
+
+void ObjectState::findFixedBytes(
+    const FixedReadMap &values,
+    std::vector<std::pair<unsigned, uint8_t> > &result) const {
+  // Fully concrete objects hold no reads.
+  if (!concreteMask)
+    return;
+
+  // Flushed bytes are reads of the root array, unless it was written to
+  // since. Look them up by the array rather than scanning the object.
+  if (updates.root && updates.root->isSymbolicArray() && !updates.head) {
+    for (FixedReadMap::const_iterator
+           it = values.lower_bound(std::make_pair(updates.root, 0u)),
+           ie = values.end();
+         it != ie && it->first.first == updates.root; ++it) {
+      unsigned offset = it->first.second;
+      if (offset < size && !isByteConcrete(offset) &&
+          !isByteKnownSymbolic(offset))
+        result.push_back(std::make_pair(offset, it->second));
+    }
+  }
+
+  if (!knownSymbolics)
+    return;
+
+  for (unsigned i = 0; i != size; ++i) {
+    const ReadExpr *re = dyn_cast_or_null<ReadExpr>(knownSymbolics[i].get());
+    if (!re || re->updates.head)
+      continue;
+    const ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index);
+    if (!CE)
+      continue;
+    FixedReadMap::const_iterator it =
+        values.find(std::make_pair(re->updates.root,
+                                   (unsigned) CE->getZExtValue(32)));
+    if (it != values.end())
+      result.push_back(std::make_pair(i, it->second));
   }
 }
 
@@ -15,6 +15,7 @@
 
 #include "llvm/ADT/StringExtras.h"
 
+#include <map>
 #include <vector>
 #include <string>
 
@@ -154,6 +155,8 @@ private:
   const MemoryObject *object;
 
   uint8_t *concreteStore;
+  // whether concreteStore was allocated by this object state
+  bool ownsConcreteStore;
   // XXX cleanup name of flushMask (its backwards or something)
   BitArray *concreteMask;
 
@@ -165,6 +168,9 @@ private:
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
 
+  // update list length at which compactUpdates() next tries to shorten it
+  mutable unsigned nextCompaction;
+
 public:
   unsigned size;
 
@@ -180,6 +186,12 @@ public:
   /// contents.
   ObjectState(const MemoryObject *mo, const Array *array);
 
+  /// Create a new object state for the given memory object whose concrete
+  /// contents are kept in \a store, which must outlive the object state.
+  /// Used for the shared image of constant globals, which is made read
+  /// only once initialized.
+  ObjectState(const MemoryObject *mo, uint8_t *store);
+
   ObjectState(const ObjectState &os);
   ~ObjectState();
 
@@ -187,6 +199,14 @@ public:
 
   void setReadOnly(bool ro) { readOnly = ro; }
 
+  /// Whether some bytes were written symbolic values which are kept
+  /// outside of the update list (see isByteKnownSymbolic).
+  bool hasKnownSymbolics() const { return knownSymbolics != 0; }
+
+  /// Return an estimate of the heap memory (in bytes) held by this
+  /// object state, i.e. what is released once it is destroyed.
+  size_t getMemoryUsage() const;
+
   // make contents all concrete and zero
   void initializeToZero();
   // make contents all concrete and random
@@ -205,6 +225,25 @@ public:
   void write32(unsigned offset, uint32_t value);
   void write64(unsigned offset, uint64_t value);
 
+  /// Copy \a count bytes starting at \a srcOffset in \a src to \a offset
+  /// in this object. The ranges may overlap (memmove semantics) and \a src
+  /// may be this object.
+  void copyFrom(unsigned offset, const ObjectState &src, unsigned srcOffset,
+                unsigned count);
+
+  /// Set \a count bytes starting at \a offset to the 8-bit \a value.
+  void fill(unsigned offset, ref<Expr> value, unsigned count);
+
+  /// Map from a byte of a symbolic array, given as the array and the
+  /// index, to a concrete value it is known to have.
+  typedef std::map<std::pair<const Array*, unsigned>, uint8_t> FixedReadMap;
+
+  /// Collect the offsets of the bytes whose current value is a read of one
+  /// of the bytes in \a values, along with the value they can be replaced
+  /// by.
+  void findFixedBytes(const FixedReadMap &values,
+                      std::vector<std::pair<unsigned, uint8_t> > &result) const;
+
 private:
   const UpdateList &getUpdates() const;
 
@@ -216,15 +255,26 @@ private:
   void write8(unsigned offset, ref<Expr> value);
   void write8(ref<Expr> offset, ref<Expr> value);
 
+  /// Read a value of the given width from a fully concrete range.
+  ref<ConstantExpr> readConcrete(unsigned offset, Expr::Width width) const;
+  /// Write a concrete value whose width is a multiple of 8.
+  void writeConcrete(unsigned offset, const llvm::APInt &value);
+
   void fastRangeCheckOffset(ref<Expr> offset, unsigned *base_r, 
                             unsigned *size_r) const;
   void flushRangeForRead(unsigned rangeBase, unsigned rangeSize) const;
   void flushRangeForWrite(unsigned rangeBase, unsigned rangeSize);
 
+  const Array *createConstantArray(
+      const std::vector<ref<ConstantExpr> > &contents) const;
+  void compactUpdates() const;
+
+  bool isRangeConcrete(unsigned offset, unsigned count) const;
   bool isByteConcrete(unsigned offset) const;
   bool isByteFlushed(unsigned offset) const;
   bool isByteKnownSymbolic(unsigned offset) const;
 
+  void markRangeConcrete(unsigned offset, unsigned count);
   void markByteConcrete(unsigned offset);
   void markByteSymbolic(unsigned offset);
   void markByteFlushed(unsigned offset);
@@ -0,0 +1,201 @@
+//===-- QueryProfiler.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "QueryProfiler.h"
+
+#include "CallPathManager.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Interpreter.h"
+#include "klee/SolverStats.h"
+#include "klee/Internal/Module/InstructionInfoTable.h"
+#include "klee/Internal/Module/KInstruction.h"
+#include "klee/Internal/Module/KModule.h"
+#include "klee/util/ExprHashMap.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+  /// The shape of a query expression.
+  struct QueryShape {
+    uint64_t nodes;
+    unsigned maxUpdateDepth;
+    std::set<const Array*> arrays;
+
+    QueryShape() : nodes(0), maxUpdateDepth(0) {}
+  };
+}
+
+static void measure(ref<Expr> e, QueryShape &shape) {
+  ExprHashSet visited;
+  std::vector<ref<Expr> > stack;
+  stack.push_back(e);
+  while (!stack.empty()) {
+    ref<Expr> cur = stack.back();
+    stack.pop_back();
+    if (!visited.insert(cur).second)
+      continue;
+
+    ++shape.nodes;
+    if (const ReadExpr *re = dyn_cast<ReadExpr>(cur)) {
+      shape.arrays.insert(re->updates.root);
+      shape.maxUpdateDepth = std::max(shape.maxUpdateDepth,
+                                      re->updates.getSize());
+    }
+    for (unsigned i = 0, n = cur->getNumKids(); i != n; ++i)
+      stack.push_back(cur->getKid(i));
+  }
+}
+
+static const char *getStage(const QueryProfiler::Sample &before) {
+  if (stats::queries > before.coreQueries)
+    return "solver";
+  if (stats::queryCexCacheHits > before.cexCacheHits)
+    return "cex-cache";
+  if (stats::queryCacheHits > before.cacheHits)
+    return "cache";
+  return "other";
+}
+
+QueryProfiler::QueryProfiler(InterpreterHandler *_handler, bool logQueries)
+  : handler(_handler), queryLog(0) {
+  if (logQueries) {
+    queryLog = handler->openOutputFile("query-profile.log");
+    if (queryLog)
+      *queryLog << "# kind stage time(us) file:line asm-line function "
+                << "nodes arrays update-depth constraints\n";
+  }
+}
+
+QueryProfiler::~QueryProfiler() {
+  delete queryLog;
+}
+
+QueryProfiler::Sample QueryProfiler::begin() const {
+  Sample sample;
+  sample.coreQueries = stats::queries;
+  sample.cacheHits = stats::queryCacheHits;
+  sample.cexCacheHits = stats::queryCexCacheHits;
+  return sample;
+}
+
+std::string QueryProfiler::getFoldedStack(const ExecutionState &state,
+                                          const char *stage) const {
+  std::vector<std::string> frames;
+  CallPathNode *cpn = state.stack.back().callPathNode;
+  if (cpn) {
+    for (; cpn && cpn->function; cpn = cpn->parent)
+      frames.push_back(cpn->function->getName().str());
+  } else {
+    // Call path tracking is off; fall back to the state's own stack.
+    for (ExecutionState::stack_ty::const_reverse_iterator
+           it = state.stack.rbegin(), ie = state.stack.rend(); it != ie; ++it)
+      frames.push_back(it->kf->function->getName().str());
+  }
+
+  std::string result;
+  for (std::vector<std::string>::reverse_iterator it = frames.rbegin(),
+         ie = frames.rend(); it != ie; ++it) {
+    result += *it;
+    result += ';';
+  }
+  result += '[';
+  result += stage;
+  result += ']';
+  return result;
+}
+
+void QueryProfiler::record(const ExecutionState &state, const char *kind,
+                           ref<Expr> expr, const Sample &before,
+                           uint64_t time,
+                           const std::vector<const Array*> &objects) {
+  const char *stage = getStage(before);
+  QueryShape shape;
+  measure(expr, shape);
+  shape.arrays.insert(objects.begin(), objects.end());
+
+  const KInstruction *ki = state.prevPC;
+  SiteProfile &site = sites[ki];
+  ++site.queries;
+  site.time += time;
+  site.coreQueries += stats::queries - before.coreQueries;
+  site.cacheHits += stats::queryCacheHits - before.cacheHits;
+  site.cexCacheHits += stats::queryCexCacheHits - before.cexCacheHits;
+  site.exprNodes += shape.nodes;
+  site.constraints += state.constraints.size();
+  site.maxArrays = std::max(site.maxArrays, (unsigned) shape.arrays.size());
+  site.maxUpdateDepth = std::max(site.maxUpdateDepth, shape.maxUpdateDepth);
+
+  stacks[getFoldedStack(state, stage)] += time;
+
+  if (queryLog) {
+    *queryLog << kind << " " << stage << " " << time << " "
+              << ki->info->file << ":" << ki->info->line << " "
+              << ki->info->assemblyLine << " "
+              << ki->inst->getParent()->getParent()->getName() << " "
+              << shape.nodes << " " << shape.arrays.size() << " "
+              << shape.maxUpdateDepth << " " << state.constraints.size()
+              << "\n";
+  }
+}
+
+namespace {
+  struct SiteTimeGreater {
+    template <class T>
+    bool operator()(const T &a, const T &b) const {
+      return a.second->time > b.second->time;
+    }
+  };
+}
+
+void QueryProfiler::dump() {
+  if (queryLog)
+    queryLog->flush();
+
+  if (llvm::raw_fd_ostream *os = handler->openOutputFile("query-sites.prof")) {
+    std::vector<std::pair<const KInstruction*, const SiteProfile*> > order;
+    for (std::map<const KInstruction*, SiteProfile>::const_iterator
+           it = sites.begin(), ie = sites.end(); it != ie; ++it)
+      order.push_back(std::make_pair(it->first, &it->second));
+    std::sort(order.begin(), order.end(), SiteTimeGreater());
+
+    *os << "# time(s) queries solver cache cex-cache avg-nodes "
+        << "avg-constraints max-arrays max-update-depth file:line asm-line "
+        << "function\n";
+    for (unsigned i = 0; i < order.size(); ++i) {
+      const KInstruction *ki = order[i].first;
+      const SiteProfile &site = *order[i].second;
+      *os << site.time / 1e6 << " " << site.queries << " "
+          << site.coreQueries << " " << site.cacheHits << " "
+          << site.cexCacheHits << " " << site.exprNodes / site.queries << " "
+          << site.constraints / site.queries << " " << site.maxArrays << " "
+          << site.maxUpdateDepth << " "
+          << ki->info->file << ":" << ki->info->line << " "
+          << ki->info->assemblyLine << " "
+          << ki->inst->getParent()->getParent()->getName() << "\n";
+    }
+    delete os;
+  }
+
+  if (llvm::raw_fd_ostream *os =
+        handler->openOutputFile("query-stacks.folded")) {
+    for (std::map<std::string, uint64_t>::const_iterator
+           it = stacks.begin(), ie = stacks.end(); it != ie; ++it)
+      *os << it->first << " " << it->second << "\n";
+    delete os;
+  }
+}
@@ -0,0 +1,89 @@
+//===-- QueryProfiler.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_QUERYPROFILER_H
+#define KLEE_QUERYPROFILER_H
+
+#include "klee/Expr.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class raw_fd_ostream;
+}
+
+namespace klee {
+  class Array;
+  class ExecutionState;
+  class InterpreterHandler;
+  struct KInstruction;
+
+  /// QueryProfiler - Attributes solver cost to the instruction and call
+  /// path which issued each query.
+  ///
+  /// The solver chain stage which answered a query is inferred from the
+  /// solver statistics it updated, so the solver chain itself needs no
+  /// knowledge of the profiler.
+  class QueryProfiler {
+  public:
+    /// Counter values taken before a query, used to tell which stage
+    /// of the solver chain answered it.
+    struct Sample {
+      uint64_t coreQueries, cacheHits, cexCacheHits;
+
+      Sample() : coreQueries(0), cacheHits(0), cexCacheHits(0) {}
+    };
+
+  private:
+    struct SiteProfile {
+      uint64_t queries;
+      uint64_t time;
+      uint64_t coreQueries, cacheHits, cexCacheHits;
+      uint64_t exprNodes, constraints;
+      unsigned maxArrays, maxUpdateDepth;
+
+      SiteProfile()
+        : queries(0), time(0), coreQueries(0), cacheHits(0),
+          cexCacheHits(0), exprNodes(0), constraints(0), maxArrays(0),
+          maxUpdateDepth(0) {}
+    };
+
+    InterpreterHandler *handler;
+    std::map<const KInstruction*, SiteProfile> sites;
+    /// Time per folded call stack, in microseconds.
+    std::map<std::string, uint64_t> stacks;
+    /// Per query records, or null if not requested.
+    llvm::raw_fd_ostream *queryLog;
+
+    std::string getFoldedStack(const ExecutionState &state,
+                               const char *stage) const;
+
+  public:
+    QueryProfiler(InterpreterHandler *_handler, bool logQueries);
+    ~QueryProfiler();
+
+    Sample begin() const;
+
+    /// Record a query issued by \a state, which took \a time
+    /// microseconds. \a objects lists the arrays of a getInitialValues
+    /// query.
+    void record(const ExecutionState &state, const char *kind,
+                ref<Expr> expr, const Sample &before, uint64_t time,
+                const std::vector<const Array*> &objects =
+                  std::vector<const Array*>());
+
+    /// Write the per site table to query-sites.prof and the folded call
+    /// stacks to query-stacks.folded, for flamegraph.pl.
+    void dump();
+  };
+}
+
+#endif
@@ -299,6 +299,87 @@ bool RandomPathSearcher::empty() {
 
 ///
 
+bool GenerationalSearcher::Child::operator<(const Child &b) const {
+  if (score != b.score)
+    return score > b.score;
+  if (generation != b.generation)
+    return generation < b.generation;
+  return order < b.order;
+}
+
+GenerationalSearcher::GenerationalSearcher(Executor &_executor)
+  : executor(_executor), running(0), generation(0), nextOrder(0) {
+}
+
+double GenerationalSearcher::getScore(ExecutionState *es) {
+  uint64_t md2u = computeMinDistToUncovered(es->pc,
+                                            es->stack.back().minDistToUncoveredOnReturn);
+  return md2u ? 1. / md2u : 0.;
+}
+
+void GenerationalSearcher::addChild(ExecutionState *es, unsigned generation) {
+  Child child = { getScore(es), generation, nextOrder++, es };
+  children[es] = queue.insert(child).first;
+}
+
+void GenerationalSearcher::removeChild(ExecutionState *es) {
+  std::map<ExecutionState*, std::set<Child>::iterator>::iterator it =
+    children.find(es);
+  if (it != children.end()) {
+    queue.erase(it->second);
+    children.erase(it);
+  }
+}
+
+ExecutionState &GenerationalSearcher::selectState() {
+  while (!running) {
+    Child best = *queue.begin();
+    removeChild(best.state);
+
+    // Scores only drop as code gets covered, so a child whose score
+    // is still current is the best one.
+    double score = getScore(best.state);
+    if (score < best.score) {
+      best.score = score;
+      children[best.state] = queue.insert(best).first;
+      continue;
+    }
+
+    running = best.state;
+    generation = best.generation;
+  }
+  return *running;
+}
+
+void GenerationalSearcher::update(ExecutionState *current,
+                                  const std::vector<ExecutionState *> &addedStates,
+                                  const std::vector<ExecutionState *> &removedStates) {
+  for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
+                                                     ie = removedStates.end();
+       it != ie; ++it) {
+    if (*it == running)
+      running = 0;
+    else
+      removeChild(*it);
+  }
+
+  // States forked off the running state make up the next generation.
+  unsigned childGeneration = current ? generation + 1 : generation;
+  for (std::vector<ExecutionState *>::const_iterator it = addedStates.begin(),
+                                                     ie = addedStates.end();
+       it != ie; ++it) {
+    ExecutionState *es = *it;
+    // Keep running the state which follows the input.
+    if (running && !executor.seedMap.count(running) &&
+        executor.seedMap.count(es)) {
+      std::swap(running, es);
+    }
+    addChild(es, childGeneration);
+  }
+}
+
+///
+
 BatchingSearcher::BatchingSearcher(Searcher *_baseSearcher,
                                    double _timeBudget,
                                    unsigned _instructionBudget) 
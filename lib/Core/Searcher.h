@@ -76,7 +76,8 @@ namespace klee {
       NURS_Depth,
       NURS_ICnt,
       NURS_CPICnt,
-      NURS_QC
+      NURS_QC,
+      Generational
     };
   };
 
@@ -180,6 +181,46 @@ namespace klee {
     }
   };
 
+  /// SAGE-style generational search. The selected state is run on a
+  /// concrete input (a seed) to completion, without querying the branches
+  /// it does not take; each of those is forked off as a child with its
+  /// condition pending (see Executor::checkPendingConstraint). Children
+  /// are scored by their distance to uncovered code, and only the best
+  /// child is checked, given an input and run next, so the children of
+  /// all generations compete.
+  class GenerationalSearcher : public Searcher {
+    struct Child {
+      double score;
+      unsigned generation;
+      unsigned order;
+      ExecutionState *state;
+
+      bool operator<(const Child &b) const;
+    };
+
+    Executor &executor;
+    ExecutionState *running;
+    unsigned generation, nextOrder;
+    std::set<Child> queue;
+    std::map<ExecutionState*, std::set<Child>::iterator> children;
+
+    double getScore(ExecutionState *es);
+    void addChild(ExecutionState *es, unsigned generation);
+    void removeChild(ExecutionState *es);
+
+  public:
+    GenerationalSearcher(Executor &_executor);
+
+    ExecutionState &selectState();
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates);
+    bool empty() { return !running && children.empty(); }
+    void printName(llvm::raw_ostream &os) {
+      os << "GenerationalSearcher\n";
+    }
+  };
+
   class BatchingSearcher : public Searcher {
     Searcher *baseSearcher;
     double timeBudget;
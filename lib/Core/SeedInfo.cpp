@@ -21,6 +21,9 @@ using namespace klee;
 
 KTestObject *SeedInfo::getNextInput(const MemoryObject *mo,
                                    bool byName) {
+  if (!input)
+    return 0;
+
   if (byName) {
     unsigned i;
     
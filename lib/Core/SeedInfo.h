@@ -24,6 +24,8 @@ namespace klee {
   class SeedInfo {
   public:
     Assignment assignment;
+    /// The seed's test, or null for a seed computed from a solution
+    /// (see Executor::seedFromSolution).
     KTest *input;
     unsigned inputPosition;
     std::set<struct KTestObject*> used;
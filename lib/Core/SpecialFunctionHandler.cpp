@@ -28,6 +28,7 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/DataLayout.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <sstream>
 
@@ -47,6 +48,23 @@ namespace {
                    cl::desc("Silently terminate paths with an infeasible "
                             "condition given to klee_assume() rather than "
                             "emitting an error (default=false)"));
+
+  cl::opt<bool>
+  NativeMemIntrinsics("native-mem-intrinsics",
+                      cl::init(true),
+                      cl::desc("Execute memcpy, memmove, mempcpy and memset "
+                               "directly on the object states when their "
+                               "pointers are concrete, instead of "
+                               "interpreting the runtime library versions "
+                               "(default=true)"));
+
+  cl::opt<unsigned>
+  MaxSymMemIntrinsicSize("max-sym-mem-intrinsic-size",
+                         cl::init(4096),
+                         cl::desc("Largest range (in bytes) for which a "
+                                  "native memory intrinsic with a symbolic "
+                                  "length is still executed natively "
+                                  "(default=4096)"));
 }
 
 
@@ -97,6 +115,7 @@ static SpecialFunctionHandler::HandlerInfo handlerInfo[] = {
   add("klee_open_merge", handleOpenMerge, false),
   add("klee_close_merge", handleCloseMerge, false),
   add("klee_prefer_cex", handlePreferCex, false),
+  add("klee_posix_copy_file_data", handlePosixCopyFileData, false),
   add("klee_posix_prefer_cex", handlePosixPreferCex, false),
   add("klee_print_expr", handlePrintExpr, false),
   add("klee_print_range", handlePrintRange, false),
@@ -136,6 +155,18 @@ static SpecialFunctionHandler::HandlerInfo handlerInfo[] = {
 #undef add
 };
 
+// Functions which keep their (runtime library) bodies, but which are
+// executed natively whenever the arguments permit it.
+static const struct {
+  const char *name;
+  SpecialFunctionHandler::FastPathHandler handler;
+} fastPathInfo[] = {
+  { "memcpy", &SpecialFunctionHandler::handleMemcpy },
+  { "memmove", &SpecialFunctionHandler::handleMemmove },
+  { "mempcpy", &SpecialFunctionHandler::handleMempcpy },
+  { "memset", &SpecialFunctionHandler::handleMemset },
+};
+
 SpecialFunctionHandler::const_iterator SpecialFunctionHandler::begin() {
   return SpecialFunctionHandler::const_iterator(handlerInfo);
 }
@@ -199,6 +230,16 @@ void SpecialFunctionHandler::bind() {
     if (f && (!hi.doNotOverride || f->isDeclaration()))
       handlers[f] = std::make_pair(hi.handler, hi.hasReturnValue);
   }
+
+  if (!NativeMemIntrinsics)
+    return;
+
+  N = sizeof(fastPathInfo)/sizeof(fastPathInfo[0]);
+  for (unsigned i=0; i<N; ++i) {
+    Function *f = executor.kmodule->module->getFunction(fastPathInfo[i].name);
+    if (f && !f->isDeclaration() && !handlers.count(f))
+      fastPaths[f] = fastPathInfo[i].handler;
+  }
 }
 
 
@@ -223,6 +264,18 @@ bool SpecialFunctionHandler::handle(ExecutionState &state,
   }
 }
 
+bool SpecialFunctionHandler::handleFastPath(ExecutionState &state,
+                                            Function *f,
+                                            KInstruction *target,
+                                            std::vector< ref<Expr> > &arguments) {
+  if (fastPaths.empty())
+    return false;
+  fast_paths_ty::iterator it = fastPaths.find(f);
+  if (it == fastPaths.end())
+    return false;
+  return (this->*(it->second))(state, target, arguments);
+}
+
 /****/
 
 // reads a concrete string from memory
@@ -640,6 +693,209 @@ void SpecialFunctionHandler::handleFree(ExecutionState &state,
   executor.executeFree(state, arguments[0]);
 }
 
+bool SpecialFunctionHandler::resolveRange(ExecutionState &state,
+                                          ref<Expr> address, uint64_t size,
+                                          const MemoryObject *&mo,
+                                          const ObjectState *&os,
+                                          const char *name) {
+  ObjectPair op;
+  ConstantExpr *CE = cast<ConstantExpr>(address);
+  if (!state.addressSpace.resolveOne(CE, op) ||
+      !op.first->getBoundsCheckPointer(address, size)->isTrue()) {
+    executor.terminateStateOnError(state,
+                                   std::string(name) + ": memory error",
+                                   Executor::Ptr, NULL,
+                                   executor.getAddressInfo(state, address));
+    return false;
+  }
+  mo = op.first;
+  os = op.second;
+  return true;
+}
+
+void SpecialFunctionHandler::handlePosixCopyFileData(ExecutionState &state,
+                                                     KInstruction *target,
+                                                     std::vector<ref<Expr> >
+                                                       &arguments) {
+  assert(arguments.size()==3 &&
+         "invalid number of arguments to klee_posix_copy_file_data");
+
+  ref<Expr> dst = executor.toUnique(state, arguments[0]);
+  ref<Expr> src = executor.toUnique(state, arguments[1]);
+  ref<Expr> count = executor.toUnique(state, arguments[2]);
+  if (!isa<ConstantExpr>(dst) || !isa<ConstantExpr>(src) ||
+      !isa<ConstantExpr>(count)) {
+    executor.terminateStateOnError(state,
+                                   "klee_posix_copy_file_data requires constant args",
+                                   Executor::User);
+    return;
+  }
+
+  uint64_t n = cast<ConstantExpr>(count)->getZExtValue();
+  if (n == 0)
+    return;
+
+  const MemoryObject *dmo, *smo;
+  const ObjectState *dos, *sos;
+  if (!resolveRange(state, dst, n, dmo, dos, "klee_posix_copy_file_data") ||
+      !resolveRange(state, src, n, smo, sos, "klee_posix_copy_file_data"))
+    return;
+
+  if (dos->readOnly) {
+    executor.terminateStateOnError(state, "memory error: object read only",
+                                   Executor::ReadOnly);
+    return;
+  }
+
+  ObjectState *wos = state.addressSpace.getWriteable(dmo, dos);
+  // The source may have been the object we just made writeable.
+  if (smo == dmo)
+    sos = wos;
+
+  uint64_t dstOffset = cast<ConstantExpr>(dst)->getZExtValue() - dmo->address;
+  uint64_t srcOffset = cast<ConstantExpr>(src)->getZExtValue() - smo->address;
+  wos->copyFrom(dstOffset, *sos, srcOffset, n);
+  state.addressSpace.noteSymbolicWrite(dmo, wos);
+}
+
+bool SpecialFunctionHandler::executeMemoryTransfer(ExecutionState &state,
+                                                   ref<Expr> dst,
+                                                   ref<Expr> src,
+                                                   ref<Expr> value,
+                                                   ref<Expr> len) {
+  len = executor.toUnique(state, len);
+  ConstantExpr *lenCE = dyn_cast<ConstantExpr>(len);
+  if (lenCE && lenCE->isZero())
+    return true;
+
+  // Anything that needs pointer resolution with forking, or could fail,
+  // is left to the interpreted version so that errors are reported at
+  // the faulting instruction.
+  dst = executor.toUnique(state, dst);
+  ConstantExpr *dstCE = dyn_cast<ConstantExpr>(dst);
+  ObjectPair dop;
+  if (!dstCE || !state.addressSpace.resolveOne(dstCE, dop) ||
+      dop.second->readOnly)
+    return false;
+  const MemoryObject *dmo = dop.first;
+  uint64_t dstOffset = dstCE->getZExtValue() - dmo->address;
+  if (dstOffset >= dmo->size)
+    return false;
+  uint64_t bound = dmo->size - dstOffset;
+
+  const MemoryObject *smo = 0;
+  const ObjectState *sos = 0;
+  uint64_t srcOffset = 0;
+  if (!src.isNull()) {
+    src = executor.toUnique(state, src);
+    ConstantExpr *srcCE = dyn_cast<ConstantExpr>(src);
+    ObjectPair sop;
+    if (!srcCE || !state.addressSpace.resolveOne(srcCE, sop))
+      return false;
+    smo = sop.first;
+    sos = sop.second;
+    srcOffset = srcCE->getZExtValue() - smo->address;
+    if (srcOffset >= smo->size)
+      return false;
+    bound = std::min(bound, smo->size - srcOffset);
+  }
+
+  if (lenCE) {
+    uint64_t n = lenCE->getZExtValue();
+    if (n > bound)
+      return false;
+
+    ObjectState *wos = state.addressSpace.getWriteable(dmo, dop.second);
+    if (smo == dmo)
+      sos = wos;
+    if (sos)
+      wos->copyFrom(dstOffset, *sos, srcOffset, n);
+    else
+      wos->fill(dstOffset, value, n);
+    state.addressSpace.noteSymbolicWrite(dmo, wos);
+    return true;
+  }
+
+  // A symbolic length is only handled if it provably stays in bounds, in
+  // which case every byte it may touch becomes a select on the length.
+  if (bound > MaxSymMemIntrinsicSize)
+    return false;
+
+  Expr::Width w = len->getWidth();
+  bool inBounds;
+  executor.solver->setTimeout(executor.coreSolverTimeout);
+  bool success = executor.solver->mustBeTrue(
+      state, UleExpr::create(len, ConstantExpr::create(bound, w)), inBounds);
+  executor.solver->setTimeout(0);
+  if (!success || !inBounds)
+    return false;
+
+  std::vector< ref<Expr> > bytes(bound);
+  for (unsigned i = 0; i != bound; ++i) {
+    ref<Expr> newByte = sos ? sos->read8(srcOffset + i) : value;
+    bytes[i] = SelectExpr::create(UltExpr::create(ConstantExpr::create(i, w),
+                                                  len),
+                                  newByte, dop.second->read8(dstOffset + i));
+  }
+
+  ObjectState *wos = state.addressSpace.getWriteable(dmo, dop.second);
+  for (unsigned i = 0; i != bound; ++i)
+    wos->write(dstOffset + i, bytes[i]);
+  state.addressSpace.noteSymbolicWrite(dmo, wos);
+  return true;
+}
+
+bool SpecialFunctionHandler::handleMemcpy(ExecutionState &state,
+                                          KInstruction *target,
+                                          std::vector<ref<Expr> > &arguments) {
+  assert(arguments.size()==3 && "invalid number of arguments to memcpy");
+
+  if (!executeMemoryTransfer(state, arguments[0], arguments[1], ref<Expr>(),
+                             arguments[2]))
+    return false;
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
+
+bool SpecialFunctionHandler::handleMemmove(ExecutionState &state,
+                                           KInstruction *target,
+                                           std::vector<ref<Expr> > &arguments) {
+  assert(arguments.size()==3 && "invalid number of arguments to memmove");
+
+  // copyFrom() already has memmove semantics.
+  if (!executeMemoryTransfer(state, arguments[0], arguments[1], ref<Expr>(),
+                             arguments[2]))
+    return false;
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
+
+bool SpecialFunctionHandler::handleMempcpy(ExecutionState &state,
+                                           KInstruction *target,
+                                           std::vector<ref<Expr> > &arguments) {
+  assert(arguments.size()==3 && "invalid number of arguments to mempcpy");
+
+  if (!executeMemoryTransfer(state, arguments[0], arguments[1], ref<Expr>(),
+                             arguments[2]))
+    return false;
+  executor.bindLocal(target, state,
+                     AddExpr::create(arguments[0], arguments[2]));
+  return true;
+}
+
+bool SpecialFunctionHandler::handleMemset(ExecutionState &state,
+                                          KInstruction *target,
+                                          std::vector<ref<Expr> > &arguments) {
+  assert(arguments.size()==3 && "invalid number of arguments to memset");
+
+  ref<Expr> value = ExtractExpr::create(arguments[1], 0, Expr::Int8);
+  if (!executeMemoryTransfer(state, arguments[0], ref<Expr>(), value,
+                             arguments[2]))
+    return false;
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
+
 void SpecialFunctionHandler::handleCheckMemoryAccess(ExecutionState &state,
                                                      KInstruction *target,
                                                      std::vector<ref<Expr> > 
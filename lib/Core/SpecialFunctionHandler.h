@@ -24,6 +24,8 @@ namespace klee {
   class Expr;
   class ExecutionState;
   struct KInstruction;
+  class MemoryObject;
+  class ObjectState;
   template<typename T> class ref;
   
   class SpecialFunctionHandler {
@@ -35,7 +37,16 @@ namespace klee {
     typedef std::map<const llvm::Function*, 
                      std::pair<Handler,bool> > handlers_ty;
 
+    /// A fast path handler executes a function natively when its
+    /// arguments allow it and returns false to have the function
+    /// executed normally otherwise.
+    typedef bool (SpecialFunctionHandler::*FastPathHandler)(
+        ExecutionState &state, KInstruction *target,
+        std::vector<ref<Expr> > &arguments);
+    typedef std::map<const llvm::Function*, FastPathHandler> fast_paths_ty;
+
     handlers_ty handlers;
+    fast_paths_ty fastPaths;
     class Executor &executor;
 
     struct HandlerInfo {
@@ -88,9 +99,24 @@ namespace klee {
                 KInstruction *target,
                 std::vector< ref<Expr> > &arguments);
 
+    /// Try to execute a call to \a f natively, for functions which
+    /// are otherwise interpreted. Returns false if the call should be
+    /// executed normally.
+    bool handleFastPath(ExecutionState &state,
+                        llvm::Function *f,
+                        KInstruction *target,
+                        std::vector< ref<Expr> > &arguments);
+
     /* Convenience routines */
 
     std::string readStringAtAddress(ExecutionState &state, ref<Expr> address);
+
+    /// Resolve the range [address, address+size) at a constant address
+    /// to the object containing it. On failure the state is terminated
+    /// with a memory error mentioning \a name and false is returned.
+    bool resolveRange(ExecutionState &state, ref<Expr> address,
+                      uint64_t size, const MemoryObject *&mo,
+                      const ObjectState *&os, const char *name);
     
     /* Handlers */
 
@@ -121,6 +147,7 @@ namespace klee {
     HANDLER(handleNew);
     HANDLER(handleNewArray);
     HANDLER(handlePreferCex);
+    HANDLER(handlePosixCopyFileData);
     HANDLER(handlePosixPreferCex);
     HANDLER(handlePrintExpr);
     HANDLER(handlePrintRange);
@@ -139,6 +166,25 @@ namespace klee {
     HANDLER(handleSubOverflow);
     HANDLER(handleDivRemOverflow);
 #undef HANDLER
+
+    /* Fast paths */
+
+#define FAST_PATH(name) bool name(ExecutionState &state, \
+                                  KInstruction *target, \
+                                  std::vector< ref<Expr> > &arguments)
+    FAST_PATH(handleMemcpy);
+    FAST_PATH(handleMemmove);
+    FAST_PATH(handleMempcpy);
+    FAST_PATH(handleMemset);
+#undef FAST_PATH
+
+  private:
+    /// Copy (or set, when \a src is null) \a len bytes natively on the
+    /// underlying objects. Returns false if the arguments require the
+    /// interpreted implementation.
+    bool executeMemoryTransfer(ExecutionState &state, ref<Expr> dst,
+                               ref<Expr> src, ref<Expr> value,
+                               ref<Expr> len);
   };
 } // End klee namespace
 
@@ -86,6 +86,13 @@ namespace {
 		      cl::init(10.),
                       cl::desc("Approximate number of seconds between istats writes (default: 10.0s)"));
 
+  cl::opt<bool>
+  IStatsIncremental("istats-incremental",
+                    cl::init(false),
+                    cl::desc("Append changed instruction level statistics to "
+                             "run.istats.delta at each istats write, and only "
+                             "write run.istats at exit (default=off)"));
+
   cl::opt<unsigned> IStatsWriteAfterInstructions(
       "istats-write-after-instructions", cl::init(0),
       cl::desc("Write istats after each n instructions, 0 to disable "
@@ -101,7 +108,25 @@ namespace {
   UseCallPaths("use-call-paths",
 	       cl::init(true),
                cl::desc("Enable calltree tracking for instruction level statistics (default=on)"));
-  
+
+  enum IStatsLayoutTy { ISL_Rows, ISL_Columns };
+
+  cl::opt<IStatsLayoutTy>
+  IStatsLayout("istats-layout",
+               cl::desc("Memory layout of instruction level statistics"),
+               cl::values(clEnumValN(ISL_Rows, "rows",
+                                     "Group the statistics of each instruction (default)"),
+                          clEnumValN(ISL_Columns, "columns",
+                                     "Group the values of each statistic")
+                          KLEE_LLVM_CL_VAL_END),
+               cl::init(ISL_Rows));
+
+  cl::opt<bool>
+  IStatsIndexAll("istats-index-all",
+                 cl::init(false),
+                 cl::desc("Keep every statistic per instruction, not only "
+                          "those written to run.istats or used by the "
+                          "searchers (default=off)"));
 }
 
 ///
@@ -110,6 +135,59 @@ bool StatsTracker::useStatistics() {
   return OutputStats || OutputIStats;
 }
 
+/// The statistics written to run.istats, as a mask of statistic IDs.
+static uint64_t getIStatsMask() {
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t istatsMask = 0;
+
+  // Max is 13, sadly
+  istatsMask |= 1ULL<<sm.getStatisticID("Queries");
+  istatsMask |= 1ULL<<sm.getStatisticID("QueriesValid");
+  istatsMask |= 1ULL<<sm.getStatisticID("QueriesInvalid");
+  istatsMask |= 1ULL<<sm.getStatisticID("QueryTime");
+  istatsMask |= 1ULL<<sm.getStatisticID("ResolveTime");
+  istatsMask |= 1ULL<<sm.getStatisticID("Instructions");
+  istatsMask |= 1ULL<<sm.getStatisticID("InstructionTimes");
+  istatsMask |= 1ULL<<sm.getStatisticID("InstructionRealTimes");
+  istatsMask |= 1ULL<<sm.getStatisticID("Forks");
+  istatsMask |= 1ULL<<sm.getStatisticID("CoveredInstructions");
+  istatsMask |= 1ULL<<sm.getStatisticID("UncoveredInstructions");
+  istatsMask |= 1ULL<<sm.getStatisticID("States");
+  istatsMask |= 1ULL<<sm.getStatisticID("MinDistToUncovered");
+
+  return istatsMask;
+}
+
+/// Select the statistics which get per instruction storage. Only those
+/// read back per instruction are kept, so that the per-step update
+/// touches a few compact rows instead of a slot for every statistic.
+static void selectIndexedStatistics() {
+  StatisticManager &sm = *theStatisticManager;
+
+  // Updated on every step or fork; keep them together at the front of
+  // each row.
+  sm.setIndexed(stats::instructions);
+  sm.setIndexed(stats::coveredInstructions);
+  sm.setIndexed(stats::uncoveredInstructions);
+  sm.setIndexed(stats::states);
+  sm.setIndexed(stats::forks);
+  sm.setIndexed(stats::instructionTime);
+  sm.setIndexed(stats::instructionRealTime);
+  sm.setIndexed(stats::minDistToUncovered);
+
+  // Read by the searchers and the static fork limits.
+  sm.setIndexed(stats::minDistToReturn);
+  sm.setIndexed(stats::trueBranches);
+  sm.setIndexed(stats::falseBranches);
+  sm.setIndexed(stats::solverTime);
+
+  uint64_t istatsMask = getIStatsMask();
+  unsigned nStats = sm.getNumStatistics();
+  for (unsigned i=0; i<nStats; i++)
+    if (IStatsIndexAll || (istatsMask & (1ULL<<i)))
+      sm.setIndexed(sm.getStatistic(i));
+}
+
 namespace klee {
   class WriteIStatsTimer : public Executor::Timer {
     StatsTracker *statsTracker;
@@ -118,7 +196,7 @@ namespace klee {
     WriteIStatsTimer(StatsTracker *_statsTracker) : statsTracker(_statsTracker) {}
     ~WriteIStatsTimer() {}
     
-    void run() { statsTracker->writeIStats(); }
+    void run() { statsTracker->writeIStatsSnapshot(); }
   };
   
   class WriteStatsTimer : public Executor::Timer {
@@ -174,6 +252,7 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     objectFilename(_objectFilename),
     statsFile(0),
     istatsFile(0),
+    istatsDeltaFile(0),
     startWallTime(util::getWallTime()),
     numBranches(0),
     fullBranches(0),
@@ -212,8 +291,11 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     }
   }
 
-  if (OutputIStats)
-    theStatisticManager->useIndexedStats(km->infos->getMaxID());
+  if (OutputIStats) {
+    selectIndexedStatistics();
+    theStatisticManager->useIndexedStats(km->infos->getMaxID(),
+                                         IStatsLayout == ISL_Columns);
+  }
 
   for (std::vector<KFunction*>::iterator it = km->functions.begin(), 
          ie = km->functions.end(); it != ie; ++it) {
@@ -258,6 +340,13 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     istatsFile = executor.interpreterHandler->openOutputFile("run.istats");
     assert(istatsFile && "unable to open istats file");
 
+    if (IStatsIncremental) {
+      istatsDeltaFile =
+        executor.interpreterHandler->openOutputFile("run.istats.delta");
+      assert(istatsDeltaFile && "unable to open istats delta file");
+      writeIStatsDeltaHeader();
+    }
+
     if (IStatsWriteInterval > 0)
       executor.addTimer(new WriteIStatsTimer(this), IStatsWriteInterval);
   }
@@ -266,6 +355,7 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
 StatsTracker::~StatsTracker() {  
   delete statsFile;
   delete istatsFile;
+  delete istatsDeltaFile;
 }
 
 void StatsTracker::done() {
@@ -275,6 +365,8 @@ void StatsTracker::done() {
   if (OutputIStats) {
     if (updateMinDistToUncovered)
       computeReachableUncovered();
+    if (istatsDeltaFile)
+      writeIStatsDelta();
     writeIStats();
   }
 }
@@ -331,7 +423,7 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
 
   if (istatsFile && IStatsWriteAfterInstructions &&
       stats::instructions % IStatsWriteAfterInstructions.getValue() == 0)
-    writeIStats();
+    writeIStatsSnapshot();
 }
 
 ///
@@ -412,6 +504,12 @@ void StatsTracker::writeStatsHeader() {
              << "'CexCacheTime',"
              << "'ForkTime',"
              << "'ResolveTime',"
+             << "'EvictedStates',"
+             << "'EvictedMemory',"
+             << "'QueryConstructCacheHits',"
+             << "'QueryConstructCacheMisses',"
+             << "'Forks',"
+             << "'StateMemory',"
 #ifdef DEBUG
 	     << "'ArrayHashTime',"
 #endif
@@ -442,6 +540,12 @@ void StatsTracker::writeStatsLine() {
              << "," << stats::cexCacheTime / 1000000.
              << "," << stats::forkTime / 1000000.
              << "," << stats::resolveTime / 1000000.
+             << "," << stats::evictedStates
+             << "," << stats::evictedMemory
+             << "," << stats::queryConstructCacheHits
+             << "," << stats::queryConstructCacheMisses
+             << "," << stats::forks
+             << "," << estimateStateMemory()
 #ifdef DEBUG
              << "," << stats::arrayHashTime / 1000000.
 #endif
@@ -449,6 +553,27 @@ void StatsTracker::writeStatsLine() {
   statsFile->flush();
 }
 
+/// Mean memory owned by a single state, estimated from an evenly spaced
+/// sample of the current states.
+uint64_t StatsTracker::estimateStateMemory() {
+  const unsigned maxSamples = 64;
+  unsigned numStates = executor.states.size();
+  if (!numStates)
+    return 0;
+
+  unsigned stride = (numStates + maxSamples - 1) / maxSamples;
+  uint64_t bytes = 0;
+  unsigned samples = 0, i = 0;
+  for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
+         ie = executor.states.end(); it != ie; ++it, ++i) {
+    if (i % stride == 0) {
+      bytes += (*it)->getOwnedMemoryUsage();
+      ++samples;
+    }
+  }
+  return bytes / samples;
+}
+
 void StatsTracker::updateStateStatistics(uint64_t addend) {
   for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
          ie = executor.states.end(); it != ie; ++it) {
@@ -462,7 +587,7 @@ void StatsTracker::updateStateStatistics(uint64_t addend) {
 
 void StatsTracker::writeIStats() {
   Module *m = executor.kmodule->module;
-  uint64_t istatsMask = 0;
+  uint64_t istatsMask = getIStatsMask();
   llvm::raw_fd_ostream &of = *istatsFile;
   
   // We assume that we didn't move the file pointer
@@ -479,25 +604,10 @@ void StatsTracker::writeIStats() {
   StatisticManager &sm = *theStatisticManager;
   unsigned nStats = sm.getNumStatistics();
 
-  // Max is 13, sadly
-  istatsMask |= 1<<sm.getStatisticID("Queries");
-  istatsMask |= 1<<sm.getStatisticID("QueriesValid");
-  istatsMask |= 1<<sm.getStatisticID("QueriesInvalid");
-  istatsMask |= 1<<sm.getStatisticID("QueryTime");
-  istatsMask |= 1<<sm.getStatisticID("ResolveTime");
-  istatsMask |= 1<<sm.getStatisticID("Instructions");
-  istatsMask |= 1<<sm.getStatisticID("InstructionTimes");
-  istatsMask |= 1<<sm.getStatisticID("InstructionRealTimes");
-  istatsMask |= 1<<sm.getStatisticID("Forks");
-  istatsMask |= 1<<sm.getStatisticID("CoveredInstructions");
-  istatsMask |= 1<<sm.getStatisticID("UncoveredInstructions");
-  istatsMask |= 1<<sm.getStatisticID("States");
-  istatsMask |= 1<<sm.getStatisticID("MinDistToUncovered");
-
   of << "positions: instr line\n";
 
   for (unsigned i=0; i<nStats; i++) {
-    if (istatsMask & (1<<i)) {
+    if (istatsMask & (1ULL<<i)) {
       Statistic &s = sm.getStatistic(i);
       of << "event: " << s.getShortName() << " : " 
          << s.getName() << "\n";
@@ -506,14 +616,14 @@ void StatsTracker::writeIStats() {
 
   of << "events: ";
   for (unsigned i=0; i<nStats; i++) {
-    if (istatsMask & (1<<i))
+    if (istatsMask & (1ULL<<i))
       of << sm.getStatistic(i).getShortName() << " ";
   }
   of << "\n";
   
   // set state counts, decremented after we process so that we don't
   // have to zero all records each time.
-  if (istatsMask & (1<<stats::states.getID()))
+  if (istatsMask & (1ULL<<stats::states.getID()))
     updateStateStatistics(1);
 
   std::string sourceFile = "";
@@ -552,7 +662,7 @@ void StatsTracker::writeIStats() {
           of << ii.assemblyLine << " ";
           of << ii.line << " ";
           for (unsigned i=0; i<nStats; i++)
-            if (istatsMask&(1<<i))
+            if (istatsMask&(1ULL<<i))
               of << sm.getIndexedValue(sm.getStatistic(i), index) << " ";
           of << "\n";
 
@@ -578,7 +688,7 @@ void StatsTracker::writeIStats() {
                 of << ii.assemblyLine << " ";
                 of << ii.line << " ";
                 for (unsigned i=0; i<nStats; i++) {
-                  if (istatsMask&(1<<i)) {
+                  if (istatsMask&(1ULL<<i)) {
                     Statistic &s = sm.getStatistic(i);
                     uint64_t value;
 
@@ -602,7 +712,7 @@ void StatsTracker::writeIStats() {
     }
   }
 
-  if (istatsMask & (1<<stats::states.getID()))
+  if (istatsMask & (1ULL<<stats::states.getID()))
     updateStateStatistics((uint64_t)-1);
   
   // Clear then end of the file if necessary (no truncate op?).
@@ -613,6 +723,119 @@ void StatsTracker::writeIStats() {
   of.flush();
 }
 
+void StatsTracker::writeIStatsSnapshot() {
+  if (istatsDeltaFile)
+    writeIStatsDelta();
+  else
+    writeIStats();
+}
+
+/// The delta file starts with the callgrind header and a map from
+/// instruction IDs to positions, grouped by file and function like
+/// run.istats. Each write then appends a "snapshot:" record listing,
+/// for every instruction whose counters changed, its ID followed by the
+/// signed change of each event. klee-istats folds the records back
+/// into callgrind format.
+void StatsTracker::writeIStatsDeltaHeader() {
+  Module *m = executor.kmodule->module;
+  llvm::raw_fd_ostream &of = *istatsDeltaFile;
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t istatsMask = getIStatsMask();
+  unsigned nStats = sm.getNumStatistics();
+
+  of << "version: 1\n";
+  of << "creator: klee\n";
+  of << "pid: " << getpid() << "\n";
+  of << "cmd: " << m->getModuleIdentifier() << "\n\n";
+  of << "positions: instr line\n";
+  for (unsigned i=0; i<nStats; i++) {
+    if (istatsMask & (1ULL<<i)) {
+      Statistic &s = sm.getStatistic(i);
+      of << "event: " << s.getShortName() << " : " 
+         << s.getName() << "\n";
+    }
+  }
+  of << "events: ";
+  for (unsigned i=0; i<nStats; i++) {
+    if (istatsMask & (1ULL<<i))
+      of << sm.getStatistic(i).getShortName() << " ";
+  }
+  of << "\n";
+  of << "ob=" << objectFilename << "\n";
+
+  std::string sourceFile = "";
+  for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
+       fnIt != fn_ie; ++fnIt) {
+    if (fnIt->isDeclaration())
+      continue;
+    Function *fn = &*fnIt;
+    const InstructionInfo &fi = executor.kmodule->infos->getFunctionInfo(fn);
+    if (fi.file != sourceFile) {
+      of << "fl=" << fi.file << "\n";
+      sourceFile = fi.file;
+    }
+    of << "fn=" << fn->getName().str() << "\n";
+    for (Function::iterator bbIt = fn->begin(), bb_ie = fn->end(); 
+         bbIt != bb_ie; ++bbIt) {
+      for (BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end(); 
+           it != ie; ++it) {
+        const InstructionInfo &ii = executor.kmodule->infos->getInfo(&*it);
+        if (ii.file != sourceFile) {
+          of << "fl=" << ii.file << "\n";
+          sourceFile = ii.file;
+        }
+        of << "i " << ii.id << " " << ii.assemblyLine << " " << ii.line
+           << "\n";
+      }
+    }
+  }
+  of.flush();
+}
+
+void StatsTracker::writeIStatsDelta() {
+  llvm::raw_fd_ostream &of = *istatsDeltaFile;
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t istatsMask = getIStatsMask();
+  unsigned nStats = sm.getNumStatistics();
+  unsigned nIndices = executor.kmodule->infos->getMaxID();
+
+  std::vector<Statistic*> events;
+  for (unsigned i=0; i<nStats; i++)
+    if (istatsMask & (1ULL<<i))
+      events.push_back(&sm.getStatistic(i));
+  unsigned nEvents = events.size();
+
+  if (istatsSnapshot.empty())
+    istatsSnapshot.resize(nIndices * nEvents);
+
+  // As in writeIStats, state counts are only materialized while writing.
+  if (istatsMask & (1ULL<<stats::states.getID()))
+    updateStateStatistics(1);
+
+  of << "snapshot: " << elapsed() << "\n";
+  for (unsigned index = 0; index < nIndices; ++index) {
+    uint64_t *last = &istatsSnapshot[index * nEvents];
+    unsigned e = 0;
+    while (e < nEvents && sm.getIndexedValue(*events[e], index) == last[e])
+      ++e;
+    if (e == nEvents)
+      continue;
+
+    of << index;
+    for (e = 0; e < nEvents; ++e) {
+      uint64_t value = sm.getIndexedValue(*events[e], index);
+      of << " " << (int64_t) (value - last[e]);
+      last[e] = value;
+    }
+    of << "\n";
+  }
+
+  if (istatsMask & (1ULL<<stats::states.getID()))
+    updateStateStatistics((uint64_t)-1);
+
+  of.flush();
+}
+
 ///
 
 typedef std::map<Instruction*, std::vector<Function*> > calltargets_ty;
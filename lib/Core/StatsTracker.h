@@ -13,6 +13,7 @@
 #include "CallPathManager.h"
 
 #include <set>
+#include <vector>
 
 namespace llvm {
   class BranchInst;
@@ -36,7 +37,10 @@ namespace klee {
     Executor &executor;
     std::string objectFilename;
 
-    llvm::raw_fd_ostream *statsFile, *istatsFile;
+    llvm::raw_fd_ostream *statsFile, *istatsFile, *istatsDeltaFile;
+    /// Per instruction values of the istats events as of the last
+    /// incremental write.
+    std::vector<uint64_t> istatsSnapshot;
     double startWallTime;
     
     unsigned numBranches;
@@ -53,7 +57,11 @@ namespace klee {
     void updateStateStatistics(uint64_t addend);
     void writeStatsHeader();
     void writeStatsLine();
+    uint64_t estimateStateMemory();
     void writeIStats();
+    void writeIStatsDeltaHeader();
+    void writeIStatsDelta();
+    void writeIStatsSnapshot();
 
   public:
     StatsTracker(Executor &_executor, std::string _objectFilename,
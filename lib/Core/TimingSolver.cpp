@@ -16,6 +16,7 @@
 #include "klee/TimerStatIncrementer.h"
 
 #include "CoreStats.h"
+#include "QueryProfiler.h"
 
 using namespace klee;
 using namespace llvm;
@@ -35,9 +36,17 @@ bool TimingSolver::evaluate(const ExecutionState& state, ref<Expr> expr,
   if (simplifyExprs)
     expr = state.constraints.simplifyExpr(expr);
 
+  QueryProfiler::Sample sample;
+  if (profiler)
+    sample = profiler->begin();
+
   bool success = solver->evaluate(Query(state.constraints, expr), result);
 
-  state.queryCost += timer.check() / 1e6;
+  uint64_t time = timer.check();
+  state.queryCost += time / 1e6;
+  ++state.queryCount;
+  if (profiler)
+    profiler->record(state, "evaluate", expr, sample, time);
 
   return success;
 }
@@ -55,9 +64,17 @@ bool TimingSolver::mustBeTrue(const ExecutionState& state, ref<Expr> expr,
   if (simplifyExprs)
     expr = state.constraints.simplifyExpr(expr);
 
+  QueryProfiler::Sample sample;
+  if (profiler)
+    sample = profiler->begin();
+
   bool success = solver->mustBeTrue(Query(state.constraints, expr), result);
 
-  state.queryCost += timer.check() / 1e6;
+  uint64_t time = timer.check();
+  state.queryCost += time / 1e6;
+  ++state.queryCount;
+  if (profiler)
+    profiler->record(state, "mustBeTrue", expr, sample, time);
 
   return success;
 }
@@ -98,9 +115,17 @@ bool TimingSolver::getValue(const ExecutionState& state, ref<Expr> expr,
   if (simplifyExprs)
     expr = state.constraints.simplifyExpr(expr);
 
+  QueryProfiler::Sample sample;
+  if (profiler)
+    sample = profiler->begin();
+
   bool success = solver->getValue(Query(state.constraints, expr), result);
 
-  state.queryCost += timer.check() / 1e6;
+  uint64_t time = timer.check();
+  state.queryCost += time / 1e6;
+  ++state.queryCount;
+  if (profiler)
+    profiler->record(state, "getValue", expr, sample, time);
 
   return success;
 }
@@ -116,11 +141,20 @@ TimingSolver::getInitialValues(const ExecutionState& state,
 
   TimerStatIncrementer timer(stats::solverTime);
 
+  QueryProfiler::Sample sample;
+  if (profiler)
+    sample = profiler->begin();
+
   bool success = solver->getInitialValues(Query(state.constraints,
                                                 ConstantExpr::alloc(0, Expr::Bool)), 
                                           objects, result);
   
-  state.queryCost += timer.check() / 1e6;
+  uint64_t time = timer.check();
+  state.queryCost += time / 1e6;
+  ++state.queryCount;
+  if (profiler)
+    profiler->record(state, "getInitialValues",
+                     ConstantExpr::alloc(0, Expr::Bool), sample, time, objects);
   
   return success;
 }
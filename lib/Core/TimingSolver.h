@@ -17,6 +17,7 @@
 
 namespace klee {
   class ExecutionState;
+  class QueryProfiler;
   class Solver;  
 
   /// TimingSolver - A simple class which wraps a solver and handles
@@ -25,6 +26,9 @@ namespace klee {
   public:
     Solver *solver;
     bool simplifyExprs;
+    /// Optional profiler told about every query which reaches the
+    /// solver chain (not owned).
+    QueryProfiler *profiler;
 
   public:
     /// TimingSolver - Construct a new timing solver.
@@ -33,7 +37,7 @@ namespace klee {
     /// simplified (via the constraint manager interface) prior to
     /// querying.
     TimingSolver(Solver *_solver, bool _simplifyExprs = true) 
-      : solver(_solver), simplifyExprs(_simplifyExprs) {}
+      : solver(_solver), simplifyExprs(_simplifyExprs), profiler(0) {}
     ~TimingSolver() {
       delete solver;
     }
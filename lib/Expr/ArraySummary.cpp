@@ -0,0 +1,81 @@
+//===-- ArraySummary.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ArraySummary.h"
+
+#include "klee/util/Bits.h"
+
+#include <map>
+
+using namespace klee;
+
+bool ArraySummary::inBoundsReads = false;
+
+ArraySummary::ArraySummary(const Array &array)
+    : numSegments(0), isLinear(false), size(array.size) {
+  assert(array.isConstantArray() && array.range <= 64 &&
+         "Can only summarize constant arrays of at most 64-bit values");
+  uint64_t mask = bits64::maxValueOfNBits(array.range);
+
+  std::map<uint64_t, std::vector<Segment> > inverse;
+  for (uint64_t i = 0; i != size; ++i) {
+    uint64_t value = array.constantValues[i]->getZExtValue();
+    std::vector<Segment> &segments = inverse[value];
+    if (!segments.empty() && segments.back().end + 1 == i)
+      segments.back().end = i;
+    else
+      segments.push_back(Segment(i, i));
+  }
+
+  entries.reserve(inverse.size());
+  for (std::map<uint64_t, std::vector<Segment> >::iterator
+         it = inverse.begin(), ie = inverse.end(); it != ie; ++it) {
+    entries.push_back(Entry(ConstantExpr::create(it->first, array.range)));
+    Entry &entry = entries.back();
+    entry.segments.swap(it->second);
+    numSegments += entry.segments.size();
+    if (hasBitmap())
+      for (std::vector<Segment>::iterator si = entry.segments.begin(),
+             se = entry.segments.end(); si != se; ++si)
+        for (uint64_t i = si->begin; i <= si->end; ++i)
+          entry.bitmap |= UINT64_C(1) << i;
+  }
+
+  // A single value is trivially linear with a zero stride, leave it to the
+  // users to pick the cheaper form.
+  if (size >= 2 && entries.size() > 1) {
+    uint64_t first = array.constantValues[0]->getZExtValue();
+    uint64_t step = (array.constantValues[1]->getZExtValue() - first) & mask;
+    isLinear = true;
+    for (uint64_t i = 2; i != size && isLinear; ++i)
+      isLinear = array.constantValues[i]->getZExtValue() ==
+                 ((first + step * i) & mask);
+    if (isLinear) {
+      base = ConstantExpr::create(first, array.range);
+      stride = ConstantExpr::create(step, array.range);
+    }
+  }
+}
+
+const ArraySummary::Entry *
+ArraySummary::getEntry(const ref<ConstantExpr> &value) const {
+  uint64_t v = value->getZExtValue();
+  unsigned lo = 0, hi = entries.size();
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    uint64_t m = entries[mid].value->getZExtValue();
+    if (m == v)
+      return &entries[mid];
+    if (m < v)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return 0;
+}
@@ -122,6 +122,15 @@ ref<Expr> ConstraintManager::simplifyExpr(ref<Expr> e) const {
   return ExprReplaceVisitor2(equalities).visit(e);
 }
 
+void ConstraintManager::rewriteEqualities(
+    const std::map< ref<Expr>, ref<Expr> > &equalities) {
+  if (equalities.empty())
+    return;
+
+  ExprReplaceVisitor2 visitor(equalities);
+  rewriteConstraints(visitor);
+}
+
 void ConstraintManager::addConstraintInternal(ref<Expr> e) {
   // rewrite any known equalities and split Ands into different conjuncts
 
@@ -17,8 +17,10 @@
 // Core. If we need to do arithmetic, we probably want to use APInt.
 #include "klee/Internal/Support/IntEvaluation.h"
 
+#include "klee/util/ArraySummary.h"
 #include "klee/util/ExprPPrinter.h"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace klee;
@@ -29,6 +31,13 @@ namespace {
   ConstArrayOpt("const-array-opt",
 	 cl::init(false),
 	 cl::desc("Enable various optimizations involving all-constant arrays."));
+
+  cl::opt<bool>
+  ConstArraySummary("const-array-summary",
+                    cl::init(true),
+                    cl::desc("Fold reads at symbolic indices of all-constant "
+                             "arrays, and their comparisons with constants, "
+                             "into expressions over the index (default=on)."));
 }
 
 /***/
@@ -487,7 +496,7 @@ Array::Array(const std::string &_name, uint64_t _size,
              const ref<ConstantExpr> *constantValuesEnd, Expr::Width _domain,
              Expr::Width _range)
     : name(_name), size(_size), domain(_domain), range(_range),
-      constantValues(constantValuesBegin, constantValuesEnd) {
+      constantValues(constantValuesBegin, constantValuesEnd), summary(0) {
 
   assert((isSymbolicArray() || constantValues.size() == size) &&
          "Invalid size for constant array!");
@@ -501,6 +510,15 @@ Array::Array(const std::string &_name, uint64_t _size,
 }
 
 Array::~Array() {
+  delete summary;
+}
+
+const ArraySummary *Array::getSummary() const {
+  if (isSymbolicArray() || range > 64)
+    return 0;
+  if (!summary)
+    summary = new ArraySummary(*this);
+  return summary;
 }
 
 unsigned Array::computeHash() {
@@ -513,6 +531,209 @@ unsigned Array::computeHash() {
 }
 /***/
 
+/// The maximal number of index ranges a read from a constant array may be
+/// folded into, unless the array is small enough to use a bitmap.
+static const unsigned MaxIndexSegments = 4;
+
+/// The maximal number of distinct values of a constant array for which a
+/// read is folded into a chain of selects.
+static const unsigned MaxSelectValues = 4;
+
+/// The maximal number of segments of a constant array without a bitmap for
+/// which comparisons with a read are folded. Trying costs time linear in
+/// the number of segments, and is bound to fail for most large arrays.
+static const unsigned MaxCmpSegments = 64;
+
+/// Return the summary of the array read by a read at index from ul, if the
+/// read is one which could be folded, or null otherwise.
+///
+/// The folds assume the index is in bounds, so nothing is folded unless the
+/// client guarantees that (see ArraySummary::setInBoundsReads). In
+/// particular, reads in queries parsed by kleaver are left alone.
+static const ArraySummary *getFoldableSummary(const UpdateList &ul,
+                                              const ref<Expr> &index) {
+  if (!ConstArraySummary || !ArraySummary::hasInBoundsReads() || ul.head ||
+      isa<ConstantExpr>(index))
+    return 0;
+  Expr::Width w = index->getWidth();
+  if (w > 64 || (w < 64 && ul.root->size > (UINT64_C(1) << w)))
+    return 0;
+  return ul.root->getSummary();
+}
+
+/// Sort the segments and merge the adjacent ones.
+static void mergeSegments(std::vector<ArraySummary::Segment> &segments) {
+  std::sort(segments.begin(), segments.end());
+  unsigned n = 0;
+  for (unsigned i = 0, e = segments.size(); i != e; ++i) {
+    if (n && segments[n - 1].end + 1 == segments[i].begin)
+      segments[n - 1].end = segments[i].end;
+    else
+      segments[n++] = segments[i];
+  }
+  segments.erase(segments.begin() + n, segments.end());
+}
+
+/// Returns a condition that index lies in one of the sorted, disjoint
+/// segments, or null if that needs more than MaxIndexSegments ranges and the
+/// array has no bitmap. Indices past the end of the array are treated as
+/// don't-cares (see getFoldableSummary).
+static ref<Expr>
+createIndexCondition(const ref<Expr> &index, const ArraySummary &summary,
+                     const std::vector<ArraySummary::Segment> &segments,
+                     uint64_t bitmap) {
+  Expr::Width w = index->getWidth();
+  if (segments.empty())
+    return ConstantExpr::alloc(0, Expr::Bool);
+
+  if (segments.size() > MaxIndexSegments) {
+    if (!summary.hasBitmap())
+      return 0;
+    // (bitmap >> index) & 1
+    return ExtractExpr::create(
+        LShrExpr::create(ConstantExpr::create(bitmap, Expr::Int64),
+                         ZExtExpr::create(index, Expr::Int64)),
+        0, Expr::Bool);
+  }
+
+  ref<Expr> res = ConstantExpr::alloc(0, Expr::Bool);
+  for (unsigned i = 0, e = segments.size(); i != e; ++i) {
+    const ArraySummary::Segment &s = segments[i];
+    ref<Expr> cond;
+    if (s.begin == 0 && s.end + 1 == summary.size) {
+      return ConstantExpr::alloc(1, Expr::Bool);
+    } else if (s.begin == s.end) {
+      cond = EqExpr::create(ConstantExpr::create(s.begin, w), index);
+    } else if (s.begin == 0) {
+      cond = UleExpr::create(index, ConstantExpr::create(s.end, w));
+    } else if (s.end + 1 == summary.size) {
+      cond = UleExpr::create(ConstantExpr::create(s.begin, w), index);
+    } else {
+      // begin <= index <= end as a single unsigned comparison.
+      cond = UleExpr::create(
+          SubExpr::create(index, ConstantExpr::create(s.begin, w)),
+          ConstantExpr::create(s.end - s.begin, w));
+    }
+    res = OrExpr::create(res, cond);
+  }
+  return res;
+}
+
+/// Tries to fold a read at a symbolic index from an all-constant array into
+/// an arithmetic expression or a chain of selects over the index. Returns
+/// null if this is not possible.
+static ref<Expr> TryFoldConstArrayRead(const UpdateList &ul,
+                                       const ref<Expr> &index) {
+  const ArraySummary *summary = getFoldableSummary(ul, index);
+  if (!summary)
+    return 0;
+
+  const std::vector<ArraySummary::Entry> &entries = summary->entries;
+  if (entries.size() == 1)
+    return entries[0].value;
+
+  if (summary->isLinear) {
+    Expr::Width range = ul.root->range;
+    ref<Expr> i = index->getWidth() > range
+                      ? ExtractExpr::create(index, 0, range)
+                      : ZExtExpr::create(index, range);
+    return AddExpr::create(summary->base, MulExpr::create(summary->stride, i));
+  }
+
+  if (entries.size() > MaxSelectValues)
+    return 0;
+
+  // The value stored in the most segments is the one left without a
+  // condition.
+  unsigned def = 0;
+  for (unsigned i = 1, e = entries.size(); i != e; ++i)
+    if (entries[i].segments.size() > entries[def].segments.size())
+      def = i;
+
+  ref<Expr> res = entries[def].value;
+  for (unsigned i = 0, e = entries.size(); i != e; ++i) {
+    if (i == def)
+      continue;
+    ref<Expr> cond = createIndexCondition(index, *summary, entries[i].segments,
+                                          entries[i].bitmap);
+    if (cond.isNull())
+      return 0;
+    res = SelectExpr::create(cond, entries[i].value, res);
+  }
+  return res;
+}
+
+/// Tries to fold the comparison of kind k between a constant and a read at a
+/// symbolic index from an all-constant array, possibly zero or sign
+/// extended, into a condition on the index, using the values the array
+/// holds. Returns null if l and r are not of this form or the condition
+/// would be too large.
+static ref<Expr> TryConstArraySummaryCmp(Expr::Kind k, const ref<Expr> &l,
+                                         const ref<Expr> &r) {
+  const ConstantExpr *c = dyn_cast<ConstantExpr>(l);
+  Expr *e = r.get();
+  bool readOnLeft = !c;
+  if (readOnLeft) {
+    c = dyn_cast<ConstantExpr>(r);
+    e = l.get();
+  }
+  if (!c)
+    return 0;
+
+  Expr::Kind ext = e->getKind();
+  if (ext == Expr::ZExt || ext == Expr::SExt)
+    e = cast<CastExpr>(e)->src.get();
+  const ReadExpr *rd = dyn_cast<ReadExpr>(e);
+  if (!rd)
+    return 0;
+
+  const ArraySummary *summary = getFoldableSummary(rd->updates, rd->index);
+  if (!summary ||
+      (!summary->hasBitmap() && summary->numSegments > MaxCmpSegments))
+    return 0;
+
+  ref<ConstantExpr> cst(const_cast<ConstantExpr *>(c));
+  std::vector<ArraySummary::Segment> in, out;
+  uint64_t inBitmap = 0, outBitmap = 0;
+  for (std::vector<ArraySummary::Entry>::const_iterator
+         it = summary->entries.begin(), ie = summary->entries.end();
+       it != ie; ++it) {
+    ref<ConstantExpr> value = it->value;
+    if (ext == Expr::ZExt)
+      value = value->ZExt(cst->getWidth());
+    else if (ext == Expr::SExt)
+      value = value->SExt(cst->getWidth());
+    const ref<ConstantExpr> &a = readOnLeft ? value : cst;
+    const ref<ConstantExpr> &b = readOnLeft ? cst : value;
+    ref<ConstantExpr> holds;
+    switch (k) {
+    case Expr::Eq: holds = a->Eq(b); break;
+    case Expr::Ult: holds = a->Ult(b); break;
+    case Expr::Ule: holds = a->Ule(b); break;
+    case Expr::Slt: holds = a->Slt(b); break;
+    case Expr::Sle: holds = a->Sle(b); break;
+    default: assert(0 && "invalid comparison kind");
+    }
+    std::vector<ArraySummary::Segment> &segments = holds->isTrue() ? in : out;
+    segments.insert(segments.end(), it->segments.begin(), it->segments.end());
+    (holds->isTrue() ? inBitmap : outBitmap) |= it->bitmap;
+  }
+
+  if (in.empty())
+    return ConstantExpr::alloc(0, Expr::Bool);
+  if (out.empty())
+    return ConstantExpr::alloc(1, Expr::Bool);
+
+  mergeSegments(in);
+  mergeSegments(out);
+  if (in.size() <= out.size())
+    return createIndexCondition(rd->index, *summary, in, inBitmap);
+  ref<Expr> cond = createIndexCondition(rd->index, *summary, out, outBitmap);
+  if (cond.isNull())
+    return 0;
+  return Expr::createIsZero(cond);
+}
+
 ref<Expr> ReadExpr::create(const UpdateList &ul, ref<Expr> index) {
   // rollback index when possible... 
 
@@ -524,7 +745,18 @@ ref<Expr> ReadExpr::create(const UpdateList &ul, ref<Expr> index) {
 
   const UpdateNode *un = ul.head;
   bool updateListHasSymbolicWrites = false;
+  ConstantExpr *constIndex = dyn_cast<ConstantExpr>(index);
   for (; un; un=un->next) {
+    // Most writes are at concrete offsets, compare those without building
+    // an expression for each node.
+    if (constIndex) {
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(un->index)) {
+        if (constIndex->getZExtValue() == CE->getZExtValue())
+          return un->value;
+        continue;
+      }
+    }
+
     ref<Expr> cond = EqExpr::create(index, un->index);
     
     if (ConstantExpr *CE = dyn_cast<ConstantExpr>(cond)) {
@@ -547,6 +779,10 @@ ref<Expr> ReadExpr::create(const UpdateList &ul, ref<Expr> index) {
     }
   }
 
+  ref<Expr> folded = TryFoldConstArrayRead(ul, index);
+  if (!folded.isNull())
+    return folded;
+
   return ReadExpr::alloc(ul, index);
 }
 
@@ -984,6 +1220,9 @@ ref<Expr>  _e_op ::create(const ref<Expr> &l, const ref<Expr> &r) { \
   if (ConstantExpr *cl = dyn_cast<ConstantExpr>(l))                     \
     if (ConstantExpr *cr = dyn_cast<ConstantExpr>(r))                   \
       return cl->_op(cr);                                               \
+  ref<Expr> folded = TryConstArraySummaryCmp(Expr::_op, l, r);          \
+  if (!folded.isNull())                                                 \
+    return folded;                                                      \
   return _e_op ## _create(l, r);                                        \
 }
 
@@ -1112,8 +1351,12 @@ static ref<Expr> EqExpr_createPartialR(const ref<ConstantExpr> &cl, Expr *r) {
                                                                       cl)),
                                    se->right.get());
     }
-  } else if (rk == Expr::Read && ConstArrayOpt) {
-    return TryConstArrayOpt(cl, static_cast<ReadExpr*>(r));
+  } else if (rk == Expr::Read) {
+    ref<Expr> folded = TryConstArraySummaryCmp(Expr::Eq, cl, r);
+    if (!folded.isNull())
+      return folded;
+    if (ConstArrayOpt)
+      return TryConstArrayOpt(cl, static_cast<ReadExpr*>(r));
   }
     
   return EqExpr_create(cl, r);
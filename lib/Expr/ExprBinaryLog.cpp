@@ -0,0 +1,521 @@
+//===-- ExprBinaryLog.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprBinaryLog.h"
+
+#include "klee/ExprBuilder.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <string.h>
+
+using namespace klee;
+
+/*
+ * The log is the magic header followed by a sequence of records, each
+ * starting with a tag byte. All integers are unsigned LEB128 varints,
+ * except query results which are zigzag encoded. IDs are 1-based and
+ * counted separately for arrays, update nodes and expressions; 0 means
+ * "none".
+ *
+ *   'A' name-length name size domain range num-constants constant*
+ *   'U' array-id next-update-id index-expr-id value-expr-id
+ *   'E' kind [kind specific operands] kid-expr-id*
+ *   'Q' kind success result time num-constraints expr-id* expr-id
+ *       num-objects array-id*
+ *   'R' (forget all IDs)
+ *
+ * Constants are written as their width followed by their 64-bit words.
+ */
+
+static const char BinaryLogMagic[4] = { 'K', 'Q', 'B', 1 };
+
+/// Reset the writer tables once this many nodes are defined.
+static const unsigned MaxBinaryLogTableSize = 1 << 20;
+
+static unsigned getNumKids(Expr::Kind kind) {
+  switch (kind) {
+  case Expr::Constant:
+    return 0;
+  case Expr::NotOptimized:
+  case Expr::Read:
+  case Expr::Extract:
+  case Expr::ZExt:
+  case Expr::SExt:
+  case Expr::Not:
+    return 1;
+  case Expr::Select:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+/***/
+
+ExprBinaryWriter::ExprBinaryWriter(llvm::raw_ostream &_os) : os(_os) {}
+
+void ExprBinaryWriter::writeHeader() {
+  os.write(BinaryLogMagic, sizeof(BinaryLogMagic));
+}
+
+void ExprBinaryWriter::writeVarint(uint64_t value) {
+  char buffer[10];
+  unsigned n = 0;
+  do {
+    unsigned char byte = value & 0x7F;
+    value >>= 7;
+    buffer[n++] = (char) (value ? byte | 0x80 : byte);
+  } while (value);
+  os.write(buffer, n);
+}
+
+void ExprBinaryWriter::writeAPInt(const llvm::APInt &value) {
+  writeVarint(value.getBitWidth());
+  const uint64_t *words = value.getRawData();
+  for (unsigned i = 0, e = value.getNumWords(); i != e; ++i)
+    writeVarint(words[i]);
+}
+
+void ExprBinaryWriter::reset() {
+  os << 'R';
+  exprIDs.clear();
+  updateIDs.clear();
+  updateLists.clear();
+  arrayIDs.clear();
+}
+
+unsigned ExprBinaryWriter::defineArray(const Array *array) {
+  std::map<const Array*, unsigned>::iterator it = arrayIDs.find(array);
+  if (it != arrayIDs.end())
+    return it->second;
+
+  os << 'A';
+  writeVarint(array->name.size());
+  os << array->name;
+  writeVarint(array->size);
+  writeVarint(array->getDomain());
+  writeVarint(array->getRange());
+  writeVarint(array->constantValues.size());
+  for (unsigned i = 0; i < array->constantValues.size(); ++i)
+    writeAPInt(array->constantValues[i]->getAPValue());
+
+  unsigned id = arrayIDs.size() + 1;
+  arrayIDs.insert(std::make_pair(array, id));
+  return id;
+}
+
+unsigned ExprBinaryWriter::defineUpdates(const UpdateList &updates) {
+  // Collect the nodes not written yet; they form a prefix of the list.
+  std::vector<const UpdateNode*> pending;
+  const UpdateNode *un = updates.head;
+  unsigned nextID = 0;
+  for (; un; un = un->next) {
+    std::map<const UpdateNode*, unsigned>::iterator it = updateIDs.find(un);
+    if (it != updateIDs.end()) {
+      nextID = it->second;
+      break;
+    }
+    pending.push_back(un);
+  }
+
+  unsigned arrayID = defineArray(updates.root);
+  // Write the oldest node first, so that each one refers back.
+  for (std::vector<const UpdateNode*>::reverse_iterator
+         it = pending.rbegin(), ie = pending.rend(); it != ie; ++it) {
+    const UpdateNode *un = *it;
+    unsigned index = defineExpr(un->index);
+    unsigned value = defineExpr(un->value);
+
+    os << 'U';
+    writeVarint(arrayID);
+    writeVarint(nextID);
+    writeVarint(index);
+    writeVarint(value);
+
+    nextID = updateIDs.size() + 1;
+    updateIDs.insert(std::make_pair(un, nextID));
+    updateLists.push_back(UpdateList(updates.root, un));
+  }
+
+  return nextID;
+}
+
+unsigned ExprBinaryWriter::defineExpr(const ref<Expr> &e) {
+  ExprHashMap<unsigned>::iterator it = exprIDs.find(e);
+  if (it != exprIDs.end())
+    return it->second;
+
+  // Define everything e refers to first.
+  unsigned arrayID = 0, updatesID = 0;
+  std::vector<unsigned> kids;
+  if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    arrayID = defineArray(re->updates.root);
+    updatesID = defineUpdates(re->updates);
+    kids.push_back(defineExpr(re->index));
+  } else {
+    for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+      kids.push_back(defineExpr(e->getKid(i)));
+  }
+
+  os << 'E';
+  writeVarint(e->getKind());
+  switch (e->getKind()) {
+  case Expr::Constant:
+    writeAPInt(cast<ConstantExpr>(e)->getAPValue());
+    break;
+  case Expr::Read:
+    writeVarint(arrayID);
+    writeVarint(updatesID);
+    break;
+  case Expr::Extract:
+    writeVarint(cast<ExtractExpr>(e)->offset);
+    writeVarint(e->getWidth());
+    break;
+  case Expr::ZExt:
+  case Expr::SExt:
+    writeVarint(e->getWidth());
+    break;
+  default:
+    break;
+  }
+  for (unsigned i = 0; i < kids.size(); ++i)
+    writeVarint(kids[i]);
+
+  unsigned id = exprIDs.size() + 1;
+  exprIDs.insert(std::make_pair(e, id));
+  return id;
+}
+
+void ExprBinaryWriter::writeQuery(const BinaryQueryRecord &query) {
+  if (exprIDs.size() > MaxBinaryLogTableSize ||
+      updateIDs.size() > MaxBinaryLogTableSize)
+    reset();
+
+  std::vector<unsigned> constraints;
+  for (unsigned i = 0; i < query.constraints.size(); ++i)
+    constraints.push_back(defineExpr(query.constraints[i]));
+  unsigned expr = defineExpr(query.expr);
+  std::vector<unsigned> objects;
+  for (unsigned i = 0; i < query.objects.size(); ++i)
+    objects.push_back(defineArray(query.objects[i]));
+
+  os << 'Q';
+  writeVarint(query.kind);
+  writeVarint(query.success);
+  writeVarint(((uint64_t) query.result << 1) ^ (uint64_t) (query.result >> 63));
+  writeVarint(query.time);
+  writeVarint(constraints.size());
+  for (unsigned i = 0; i < constraints.size(); ++i)
+    writeVarint(constraints[i]);
+  writeVarint(expr);
+  writeVarint(objects.size());
+  for (unsigned i = 0; i < objects.size(); ++i)
+    writeVarint(objects[i]);
+}
+
+/***/
+
+ExprBinaryReader::ExprBinaryReader(const char *begin, const char *_end,
+                                   ArrayCache &_arrayCache,
+                                   ExprBuilder *_builder)
+  : pos((const unsigned char*) begin), end((const unsigned char*) _end),
+    arrayCache(_arrayCache), builder(_builder) {
+  if (isBinaryLog(begin, _end))
+    pos += sizeof(BinaryLogMagic);
+  else
+    fail("missing binary query log header");
+}
+
+bool ExprBinaryReader::isBinaryLog(const char *begin, const char *end) {
+  return (size_t) (end - begin) >= sizeof(BinaryLogMagic) &&
+    memcmp(begin, BinaryLogMagic, sizeof(BinaryLogMagic)) == 0;
+}
+
+bool ExprBinaryReader::fail(const std::string &message) {
+  if (error.empty())
+    error = message;
+  pos = end;
+  return false;
+}
+
+bool ExprBinaryReader::readVarint(uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (pos == end)
+      return fail("truncated record");
+    unsigned char byte = *pos++;
+    value |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return fail("malformed integer");
+}
+
+bool ExprBinaryReader::readID(unsigned &id) {
+  uint64_t value;
+  if (!readVarint(value))
+    return false;
+  id = (unsigned) value;
+  return true;
+}
+
+bool ExprBinaryReader::readAPInt(llvm::APInt &value) {
+  unsigned width;
+  if (!readID(width))
+    return false;
+  if (!width)
+    return fail("zero width constant");
+
+  std::vector<uint64_t> words((width + 63) / 64);
+  for (unsigned i = 0; i < words.size(); ++i)
+    if (!readVarint(words[i]))
+      return false;
+  value = llvm::APInt(width, words.size(), &words[0]);
+  return true;
+}
+
+bool ExprBinaryReader::readExprRef(ref<Expr> &e) {
+  unsigned id;
+  if (!readID(id))
+    return false;
+  if (id == 0 || id > exprs.size())
+    return fail("reference to undefined expression");
+  e = exprs[id - 1];
+  return true;
+}
+
+bool ExprBinaryReader::readArrayRef(const Array *&array) {
+  unsigned id;
+  if (!readID(id))
+    return false;
+  if (id == 0 || id > arrays.size())
+    return fail("reference to undefined array");
+  array = arrays[id - 1];
+  return true;
+}
+
+bool ExprBinaryReader::readArray() {
+  uint64_t length;
+  if (!readVarint(length))
+    return false;
+  if ((uint64_t) (end - pos) < length)
+    return fail("truncated array name");
+  std::string name((const char*) pos, length);
+  pos += length;
+
+  uint64_t size, domain, range, numConstants;
+  if (!readVarint(size) || !readVarint(domain) || !readVarint(range) ||
+      !readVarint(numConstants))
+    return false;
+  if (numConstants && numConstants != size)
+    return fail("constant array of the wrong size");
+
+  std::vector< ref<ConstantExpr> > constants;
+  for (uint64_t i = 0; i < numConstants; ++i) {
+    llvm::APInt value;
+    if (!readAPInt(value))
+      return false;
+    constants.push_back(ConstantExpr::alloc(value));
+  }
+
+  if (constants.empty())
+    arrays.push_back(arrayCache.CreateArray(name, size, 0, 0, domain, range));
+  else
+    arrays.push_back(arrayCache.CreateArray(name, size, &constants[0],
+                                            &constants[0] + constants.size(),
+                                            domain, range));
+  return true;
+}
+
+bool ExprBinaryReader::readUpdate() {
+  const Array *root;
+  unsigned next;
+  ref<Expr> index, value;
+  if (!readArrayRef(root) || !readID(next))
+    return false;
+  if (next > updates.size())
+    return fail("reference to undefined update");
+  if (!readExprRef(index) || !readExprRef(value))
+    return false;
+
+  UpdateList ul(root, next ? updates[next - 1].head : 0);
+  ul.extend(index, value);
+  updates.push_back(ul);
+  return true;
+}
+
+bool ExprBinaryReader::readExpr() {
+  unsigned kindValue;
+  if (!readID(kindValue))
+    return false;
+  if (kindValue > Expr::LastKind)
+    return fail("unknown expression kind");
+  Expr::Kind kind = (Expr::Kind) kindValue;
+
+  llvm::APInt constant;
+  const Array *root = 0;
+  unsigned updatesID = 0, offset = 0, width = 0;
+  switch (kind) {
+  case Expr::Constant:
+    if (!readAPInt(constant))
+      return false;
+    break;
+  case Expr::Read:
+    if (!readArrayRef(root) || !readID(updatesID))
+      return false;
+    if (updatesID > updates.size())
+      return fail("reference to undefined update");
+    break;
+  case Expr::Extract:
+    if (!readID(offset) || !readID(width))
+      return false;
+    break;
+  case Expr::ZExt:
+  case Expr::SExt:
+    if (!readID(width))
+      return false;
+    break;
+  default:
+    break;
+  }
+
+  ref<Expr> kids[3];
+  for (unsigned i = 0, n = getNumKids(kind); i != n; ++i)
+    if (!readExprRef(kids[i]))
+      return false;
+
+  ref<Expr> e;
+  switch (kind) {
+  case Expr::Constant:
+    e = builder->Constant(constant);
+    break;
+  case Expr::NotOptimized:
+    e = builder->NotOptimized(kids[0]);
+    break;
+  case Expr::Read:
+    e = builder->Read(UpdateList(root, updatesID ?
+                                 updates[updatesID - 1].head : 0),
+                      kids[0]);
+    break;
+  case Expr::Select:
+    e = builder->Select(kids[0], kids[1], kids[2]);
+    break;
+  case Expr::Concat:
+    e = builder->Concat(kids[0], kids[1]);
+    break;
+  case Expr::Extract:
+    e = builder->Extract(kids[0], offset, width);
+    break;
+  case Expr::ZExt:
+    e = builder->ZExt(kids[0], width);
+    break;
+  case Expr::SExt:
+    e = builder->SExt(kids[0], width);
+    break;
+  case Expr::Not:
+    e = builder->Not(kids[0]);
+    break;
+
+#define BINARY_EXPR_CASE(T)                 \
+  case Expr::T:                             \
+    e = builder->T(kids[0], kids[1]);       \
+    break;
+
+  BINARY_EXPR_CASE(Add);
+  BINARY_EXPR_CASE(Sub);
+  BINARY_EXPR_CASE(Mul);
+  BINARY_EXPR_CASE(UDiv);
+  BINARY_EXPR_CASE(SDiv);
+  BINARY_EXPR_CASE(URem);
+  BINARY_EXPR_CASE(SRem);
+  BINARY_EXPR_CASE(And);
+  BINARY_EXPR_CASE(Or);
+  BINARY_EXPR_CASE(Xor);
+  BINARY_EXPR_CASE(Shl);
+  BINARY_EXPR_CASE(LShr);
+  BINARY_EXPR_CASE(AShr);
+  BINARY_EXPR_CASE(Eq);
+  BINARY_EXPR_CASE(Ne);
+  BINARY_EXPR_CASE(Ult);
+  BINARY_EXPR_CASE(Ule);
+  BINARY_EXPR_CASE(Ugt);
+  BINARY_EXPR_CASE(Uge);
+  BINARY_EXPR_CASE(Slt);
+  BINARY_EXPR_CASE(Sle);
+  BINARY_EXPR_CASE(Sgt);
+  BINARY_EXPR_CASE(Sge);
+#undef BINARY_EXPR_CASE
+
+  default:
+    return fail("unknown expression kind");
+  }
+
+  exprs.push_back(e);
+  return true;
+}
+
+bool ExprBinaryReader::readQuery(BinaryQueryRecord &query) {
+  while (pos != end) {
+    switch (*pos++) {
+    case 'A':
+      if (!readArray())
+        return false;
+      break;
+    case 'U':
+      if (!readUpdate())
+        return false;
+      break;
+    case 'E':
+      if (!readExpr())
+        return false;
+      break;
+    case 'R':
+      exprs.clear();
+      updates.clear();
+      arrays.clear();
+      break;
+    case 'Q': {
+      uint64_t kind, success, result, time, numConstraints, numObjects;
+      if (!readVarint(kind) || !readVarint(success) || !readVarint(result) ||
+          !readVarint(time) || !readVarint(numConstraints))
+        return false;
+      if (kind > BinaryQueryRecord::InitialValues)
+        return fail("unknown query kind");
+
+      query.kind = (BinaryQueryRecord::Kind) kind;
+      query.success = success != 0;
+      query.result = (int64_t) (result >> 1) ^ -(int64_t) (result & 1);
+      query.time = time;
+      query.constraints.clear();
+      query.objects.clear();
+
+      for (uint64_t i = 0; i < numConstraints; ++i) {
+        ref<Expr> e;
+        if (!readExprRef(e))
+          return false;
+        query.constraints.push_back(e);
+      }
+      if (!readExprRef(query.expr) || !readVarint(numObjects))
+        return false;
+      for (uint64_t i = 0; i < numObjects; ++i) {
+        const Array *array;
+        if (!readArrayRef(array))
+          return false;
+        query.objects.push_back(array);
+      }
+      return true;
+    }
+    default:
+      return fail("unknown record");
+    }
+  }
+  return false;
+}
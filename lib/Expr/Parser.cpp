@@ -15,6 +15,7 @@
 #include "klee/Constraints.h"
 #include "klee/ExprBuilder.h"
 #include "klee/Solver.h"
+#include "klee/util/ExprBinaryLog.h"
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ArrayCache.h"
 
@@ -1637,6 +1638,59 @@ void QueryCommand::dump() {
                            false);
 }
 
+namespace {
+  /// BinaryLogParser - Presents the queries of a binary query log (see
+  /// ExprBinaryWriter) as query commands.
+  class BinaryLogParser : public Parser {
+    const std::string Filename;
+    ExprBuilder *Builder;
+    ArrayCache TheArrayCache;
+    ExprBinaryReader Reader;
+    unsigned MaxErrors;
+    unsigned NumErrors;
+
+  public:
+    BinaryLogParser(const std::string _Filename, const MemoryBuffer *MB,
+                    ExprBuilder *_Builder)
+      : Filename(_Filename), Builder(_Builder),
+        Reader(MB->getBufferStart(), MB->getBufferEnd(), TheArrayCache,
+               _Builder),
+        MaxErrors(~0u), NumErrors(0) {}
+
+    virtual void SetMaxErrors(unsigned N) { MaxErrors = N; }
+    virtual unsigned GetNumErrors() const { return NumErrors; }
+
+    virtual Decl *ParseTopLevelDecl() {
+      BinaryQueryRecord Record;
+      if (!Reader.readQuery(Record)) {
+        if (!Reader.getError().empty()) {
+          if (NumErrors++ < MaxErrors)
+            llvm::errs() << Filename << ": error: " << Reader.getError()
+                         << "\n";
+        }
+        return 0;
+      }
+
+      std::vector<ExprHandle> Values;
+      std::vector<const Array*> Objects;
+      ExprHandle Query = Record.expr;
+      switch (Record.kind) {
+      case BinaryQueryRecord::Truth:
+      case BinaryQueryRecord::Validity:
+        break;
+      case BinaryQueryRecord::Value:
+        Values.push_back(Record.expr);
+        Query = Builder->False();
+        break;
+      case BinaryQueryRecord::InitialValues:
+        Objects = Record.objects;
+        break;
+      }
+      return new QueryCommand(Record.constraints, Query, Values, Objects);
+    }
+  };
+}
+
 // Public parser API
 
 Parser::Parser() {
@@ -1647,6 +1701,10 @@ Parser::~Parser() {
 
 Parser *Parser::Create(const std::string Filename, const MemoryBuffer *MB,
                        ExprBuilder *Builder, bool ClearArrayAfterQuery) {
+  if (ExprBinaryReader::isBinaryLog(MB->getBufferStart(),
+                                    MB->getBufferEnd()))
+    return new BinaryLogParser(Filename, MB, Builder);
+
   ParserImpl *P = new ParserImpl(Filename, MB, Builder, ClearArrayAfterQuery);
   P->Initialize();
   return P;
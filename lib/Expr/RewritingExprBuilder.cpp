@@ -0,0 +1,594 @@
+//===-- RewritingExprBuilder.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ExprBuilder.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+  cl::list<std::string>
+  DisableRewrite("disable-rewrite",
+                 cl::CommaSeparated,
+                 cl::desc("Expression rewrite rules not to apply (see "
+                          "rewrites.stats for their names)"),
+                 cl::value_desc("rule,..."));
+
+  /// Operands - The operands of an expression about to be built. Kids not
+  /// taken by the kind of expression are null; Offset and Width are only
+  /// used by Extract and casts.
+  struct Operands {
+    ref<Expr> Kids[3];
+    unsigned Offset;
+    Expr::Width Width;
+
+    Operands(const ref<Expr> &A, const ref<Expr> &B = 0,
+             const ref<Expr> &C = 0, unsigned _Offset = 0,
+             Expr::Width _Width = 0)
+      : Offset(_Offset), Width(_Width) {
+      Kids[0] = A;
+      Kids[1] = B;
+      Kids[2] = C;
+    }
+  };
+
+  /// RewriteRule - A rule rewriting expressions of one kind. Apply returns
+  /// the rewritten expression, built with the given builder so that it is
+  /// rewritten in turn, or null if the rule does not match. Rules must
+  /// make expressions smaller or more canonical, so that rewriting ends.
+  struct RewriteRule {
+    const char *Name;
+    Expr::Kind Kind;
+    ref<Expr> (*Apply)(ExprBuilder &B, const Operands &Ops);
+  };
+}
+
+/***/
+
+static ref<Expr> allOnes(Expr::Width W) {
+  return ConstantExpr::alloc(APInt::getAllOnesValue(W));
+}
+
+/// Return the expression E is the negation of, or null.
+static ref<Expr> getNegated(const ref<Expr> &E) {
+  if (const NotExpr *NE = dyn_cast<NotExpr>(E))
+    return NE->expr;
+  if (const EqExpr *EE = dyn_cast<EqExpr>(E))
+    if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(EE->left))
+      if (CE->getWidth() == Expr::Bool && CE->isFalse())
+        return EE->right;
+  return 0;
+}
+
+static bool isComplement(const ref<Expr> &A, const ref<Expr> &B) {
+  ref<Expr> NA = getNegated(A), NB = getNegated(B);
+  return (!NA.isNull() && NA == B) || (!NB.isNull() && NB == A);
+}
+
+/// Return n if CE is 2^n, or -1.
+static int getLog2(const ConstantExpr *CE) {
+  const APInt &V = CE->getAPValue();
+  return V.isPowerOf2() ? (int) V.logBase2() : -1;
+}
+
+static ref<Expr> buildBinary(ExprBuilder &B, Expr::Kind K,
+                             const ref<Expr> &LHS, const ref<Expr> &RHS) {
+  switch (K) {
+  case Expr::Add: return B.Add(LHS, RHS);
+  case Expr::Sub: return B.Sub(LHS, RHS);
+  case Expr::Mul: return B.Mul(LHS, RHS);
+  case Expr::UDiv: return B.UDiv(LHS, RHS);
+  case Expr::SDiv: return B.SDiv(LHS, RHS);
+  case Expr::URem: return B.URem(LHS, RHS);
+  case Expr::SRem: return B.SRem(LHS, RHS);
+  case Expr::And: return B.And(LHS, RHS);
+  case Expr::Or: return B.Or(LHS, RHS);
+  case Expr::Xor: return B.Xor(LHS, RHS);
+  case Expr::Shl: return B.Shl(LHS, RHS);
+  case Expr::LShr: return B.LShr(LHS, RHS);
+  case Expr::AShr: return B.AShr(LHS, RHS);
+  case Expr::Eq: return B.Eq(LHS, RHS);
+  case Expr::Ne: return B.Ne(LHS, RHS);
+  case Expr::Ult: return B.Ult(LHS, RHS);
+  case Expr::Ule: return B.Ule(LHS, RHS);
+  case Expr::Ugt: return B.Ugt(LHS, RHS);
+  case Expr::Uge: return B.Uge(LHS, RHS);
+  case Expr::Slt: return B.Slt(LHS, RHS);
+  case Expr::Sle: return B.Sle(LHS, RHS);
+  case Expr::Sgt: return B.Sgt(LHS, RHS);
+  case Expr::Sge: return B.Sge(LHS, RHS);
+  default:
+    assert(0 && "not a binary expression kind");
+    return 0;
+  }
+}
+
+// Bit-level simplification.
+
+// X & X ==> X, X | X ==> X
+static ref<Expr> rewriteIdempotent(ExprBuilder &B, const Operands &Ops) {
+  return Ops.Kids[0] == Ops.Kids[1] ? Ops.Kids[0] : 0;
+}
+
+// X ^ X ==> 0
+static ref<Expr> rewriteXorSelf(ExprBuilder &B, const Operands &Ops) {
+  if (Ops.Kids[0] != Ops.Kids[1])
+    return 0;
+  return B.Constant(0, Ops.Kids[0]->getWidth());
+}
+
+// X & ~X ==> 0
+static ref<Expr> rewriteAndComplement(ExprBuilder &B, const Operands &Ops) {
+  if (!isComplement(Ops.Kids[0], Ops.Kids[1]))
+    return 0;
+  return B.Constant(0, Ops.Kids[0]->getWidth());
+}
+
+// X | ~X ==> -1
+static ref<Expr> rewriteOrComplement(ExprBuilder &B, const Operands &Ops) {
+  if (!isComplement(Ops.Kids[0], Ops.Kids[1]))
+    return 0;
+  return allOnes(Ops.Kids[0]->getWidth());
+}
+
+// ~~X ==> X
+static ref<Expr> rewriteNotNot(ExprBuilder &B, const Operands &Ops) {
+  if (const NotExpr *NE = dyn_cast<NotExpr>(Ops.Kids[0]))
+    return NE->expr;
+  return 0;
+}
+
+// X << 0 ==> X, and likewise for the right shifts
+static ref<Expr> rewriteShiftZero(ExprBuilder &B, const Operands &Ops) {
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[1]))
+    if (CE->isZero())
+      return Ops.Kids[0];
+  return 0;
+}
+
+// C & zext(X) ==> zext(trunc(C) & X)
+static ref<Expr> rewriteAndZExt(ExprBuilder &B, const Operands &Ops) {
+  for (unsigned i = 0; i != 2; ++i) {
+    const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[i]);
+    const ZExtExpr *ZE = dyn_cast<ZExtExpr>(Ops.Kids[1 - i]);
+    if (CE && ZE) {
+      Expr::Width W = ZE->src->getWidth();
+      return B.ZExt(B.And(CE->Extract(0, W), ZE->src), CE->getWidth());
+    }
+  }
+  return 0;
+}
+
+// Extract and concat fusion.
+
+// extract(zext(X)) ==> extract(X), 0, or zext(extract(X))
+static ref<Expr> rewriteExtractZExt(ExprBuilder &B, const Operands &Ops) {
+  const ZExtExpr *ZE = dyn_cast<ZExtExpr>(Ops.Kids[0]);
+  if (!ZE)
+    return 0;
+  Expr::Width SrcWidth = ZE->src->getWidth();
+  if (Ops.Offset + Ops.Width <= SrcWidth)
+    return B.Extract(ZE->src, Ops.Offset, Ops.Width);
+  if (Ops.Offset >= SrcWidth)
+    return B.Constant(0, Ops.Width);
+  return B.ZExt(B.Extract(ZE->src, Ops.Offset, SrcWidth - Ops.Offset),
+                Ops.Width);
+}
+
+// extract(sext(X)) ==> extract(X), when only bits of X are taken
+static ref<Expr> rewriteExtractSExt(ExprBuilder &B, const Operands &Ops) {
+  const SExtExpr *SE = dyn_cast<SExtExpr>(Ops.Kids[0]);
+  if (!SE || Ops.Offset + Ops.Width > SE->src->getWidth())
+    return 0;
+  return B.Extract(SE->src, Ops.Offset, Ops.Width);
+}
+
+// extract(extract(X)) ==> extract(X)
+static ref<Expr> rewriteExtractExtract(ExprBuilder &B, const Operands &Ops) {
+  const ExtractExpr *EE = dyn_cast<ExtractExpr>(Ops.Kids[0]);
+  if (!EE)
+    return 0;
+  return B.Extract(EE->expr, EE->offset + Ops.Offset, Ops.Width);
+}
+
+// zext(zext(X)) ==> zext(X)
+static ref<Expr> rewriteZExtZExt(ExprBuilder &B, const Operands &Ops) {
+  const ZExtExpr *ZE = dyn_cast<ZExtExpr>(Ops.Kids[0]);
+  if (!ZE || Ops.Width < ZE->getWidth())
+    return 0;
+  return B.ZExt(ZE->src, Ops.Width);
+}
+
+// sext(sext(X)) ==> sext(X)
+static ref<Expr> rewriteSExtSExt(ExprBuilder &B, const Operands &Ops) {
+  const SExtExpr *SE = dyn_cast<SExtExpr>(Ops.Kids[0]);
+  if (!SE || Ops.Width < SE->getWidth())
+    return 0;
+  return B.SExt(SE->src, Ops.Width);
+}
+
+// concat(0, X) ==> zext(X)
+static ref<Expr> rewriteConcatZero(ExprBuilder &B, const Operands &Ops) {
+  const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[0]);
+  if (!CE || !CE->isZero() || isa<ConstantExpr>(Ops.Kids[1]))
+    return 0;
+  return B.ZExt(Ops.Kids[1], CE->getWidth() + Ops.Kids[1]->getWidth());
+}
+
+// concat(extract(X), concat(extract(X), Y)) ==> concat(extract(X), Y),
+// for adjacent extracts of the same expression
+static ref<Expr> rewriteConcatExtracts(ExprBuilder &B, const Operands &Ops) {
+  const ExtractExpr *Hi = dyn_cast<ExtractExpr>(Ops.Kids[0]);
+  const ConcatExpr *CE = dyn_cast<ConcatExpr>(Ops.Kids[1]);
+  if (!Hi || !CE)
+    return 0;
+  const ExtractExpr *Lo = dyn_cast<ExtractExpr>(CE->getLeft());
+  if (!Lo || Lo->expr != Hi->expr || Lo->offset + Lo->width != Hi->offset)
+    return 0;
+  return B.Concat(B.Extract(Hi->expr, Lo->offset, Hi->width + Lo->width),
+                  CE->getRight());
+}
+
+// Select lifting.
+
+// C ? X : X ==> X
+static ref<Expr> rewriteSelectSame(ExprBuilder &B, const Operands &Ops) {
+  return Ops.Kids[1] == Ops.Kids[2] ? Ops.Kids[1] : 0;
+}
+
+// C ? true : false ==> C, C ? false : true ==> not C
+static ref<Expr> rewriteSelectBool(ExprBuilder &B, const Operands &Ops) {
+  const ConstantExpr *T = dyn_cast<ConstantExpr>(Ops.Kids[1]);
+  const ConstantExpr *F = dyn_cast<ConstantExpr>(Ops.Kids[2]);
+  if (!T || !F || T->getWidth() != Expr::Bool || T->isTrue() == F->isTrue())
+    return 0;
+  return T->isTrue() ? Ops.Kids[0] : B.Eq(B.False(), Ops.Kids[0]);
+}
+
+// (not C) ? X : Y ==> C ? Y : X
+static ref<Expr> rewriteSelectNotCond(ExprBuilder &B, const Operands &Ops) {
+  ref<Expr> Cond = getNegated(Ops.Kids[0]);
+  if (Cond.isNull())
+    return 0;
+  return B.Select(Cond, Ops.Kids[2], Ops.Kids[1]);
+}
+
+// C ? (C ? X : Y) : Z ==> C ? X : Z, C ? X : (C ? Y : Z) ==> C ? X : Z
+static ref<Expr> rewriteSelectNested(ExprBuilder &B, const Operands &Ops) {
+  const ref<Expr> &Cond = Ops.Kids[0];
+  if (const SelectExpr *SE = dyn_cast<SelectExpr>(Ops.Kids[1]))
+    if (SE->cond == Cond)
+      return B.Select(Cond, SE->trueExpr, Ops.Kids[2]);
+  if (const SelectExpr *SE = dyn_cast<SelectExpr>(Ops.Kids[2]))
+    if (SE->cond == Cond)
+      return B.Select(Cond, Ops.Kids[1], SE->falseExpr);
+  return 0;
+}
+
+/// Lift a binary operation with a constant over a select of constants:
+/// (C ? K1 : K2) op K ==> C ? (K1 op K) : (K2 op K), and likewise with
+/// the select on the right.
+template<Expr::Kind K>
+static ref<Expr> rewriteLiftSelect(ExprBuilder &B, const Operands &Ops) {
+  for (unsigned i = 0; i != 2; ++i) {
+    const SelectExpr *SE = dyn_cast<SelectExpr>(Ops.Kids[i]);
+    const ref<Expr> &Other = Ops.Kids[1 - i];
+    if (!SE || !isa<ConstantExpr>(Other) ||
+        !isa<ConstantExpr>(SE->trueExpr) || !isa<ConstantExpr>(SE->falseExpr))
+      continue;
+    if (i == 0)
+      return B.Select(SE->cond, buildBinary(B, K, SE->trueExpr, Other),
+                      buildBinary(B, K, SE->falseExpr, Other));
+    return B.Select(SE->cond, buildBinary(B, K, Other, SE->trueExpr),
+                    buildBinary(B, K, Other, SE->falseExpr));
+  }
+  return 0;
+}
+
+// Arithmetic canonicalization.
+
+// X + X ==> X << 1
+static ref<Expr> rewriteAddSelf(ExprBuilder &B, const Operands &Ops) {
+  Expr::Width W = Ops.Kids[0]->getWidth();
+  if (Ops.Kids[0] != Ops.Kids[1] || W == Expr::Bool)
+    return 0;
+  return B.Shl(Ops.Kids[0], B.Constant(1, W));
+}
+
+// X * 2^n ==> X << n
+static ref<Expr> rewriteMulPow2(ExprBuilder &B, const Operands &Ops) {
+  for (unsigned i = 0; i != 2; ++i) {
+    if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[i])) {
+      int N = getLog2(CE);
+      if (N > 0)
+        return B.Shl(Ops.Kids[1 - i], B.Constant(N, CE->getWidth()));
+    }
+  }
+  return 0;
+}
+
+// X u/ 2^n ==> X >> n
+static ref<Expr> rewriteUDivPow2(ExprBuilder &B, const Operands &Ops) {
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[1])) {
+    int N = getLog2(CE);
+    if (N > 0)
+      return B.LShr(Ops.Kids[0], B.Constant(N, CE->getWidth()));
+  }
+  return 0;
+}
+
+// X u% 2^n ==> X & (2^n - 1)
+static ref<Expr> rewriteURemPow2(ExprBuilder &B, const Operands &Ops) {
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[1]))
+    if (getLog2(CE) >= 0)
+      return B.And(Ops.Kids[0], B.Constant(CE->getAPValue() - 1));
+  return 0;
+}
+
+// X != Y ==> !(X == Y)
+static ref<Expr> rewriteNe(ExprBuilder &B, const Operands &Ops) {
+  return B.Eq(B.False(), B.Eq(Ops.Kids[0], Ops.Kids[1]));
+}
+
+// X > Y ==> Y < X, X >= Y ==> Y <= X (unsigned and signed)
+static ref<Expr> rewriteUgt(ExprBuilder &B, const Operands &Ops) {
+  return B.Ult(Ops.Kids[1], Ops.Kids[0]);
+}
+
+static ref<Expr> rewriteUge(ExprBuilder &B, const Operands &Ops) {
+  return B.Ule(Ops.Kids[1], Ops.Kids[0]);
+}
+
+static ref<Expr> rewriteSgt(ExprBuilder &B, const Operands &Ops) {
+  return B.Slt(Ops.Kids[1], Ops.Kids[0]);
+}
+
+static ref<Expr> rewriteSge(ExprBuilder &B, const Operands &Ops) {
+  return B.Sle(Ops.Kids[1], Ops.Kids[0]);
+}
+
+// X u< 0 ==> false, -1 u< X ==> false
+static ref<Expr> rewriteUltBound(ExprBuilder &B, const Operands &Ops) {
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[1]))
+    if (CE->isZero())
+      return B.False();
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[0]))
+    if (CE->isAllOnes())
+      return B.False();
+  return 0;
+}
+
+// 0 u<= X ==> true, X u<= -1 ==> true
+static ref<Expr> rewriteUleBound(ExprBuilder &B, const Operands &Ops) {
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[0]))
+    if (CE->isZero())
+      return B.True();
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(Ops.Kids[1]))
+    if (CE->isAllOnes())
+      return B.True();
+  return 0;
+}
+
+#define LIFT_SELECT(_kind, _name) \
+  { "lift-select-" _name, Expr::_kind, rewriteLiftSelect<Expr::_kind> }
+
+static const RewriteRule Rules[] = {
+  { "and-idempotent", Expr::And, rewriteIdempotent },
+  { "or-idempotent", Expr::Or, rewriteIdempotent },
+  { "xor-self", Expr::Xor, rewriteXorSelf },
+  { "and-complement", Expr::And, rewriteAndComplement },
+  { "or-complement", Expr::Or, rewriteOrComplement },
+  { "not-not", Expr::Not, rewriteNotNot },
+  { "shl-zero", Expr::Shl, rewriteShiftZero },
+  { "lshr-zero", Expr::LShr, rewriteShiftZero },
+  { "ashr-zero", Expr::AShr, rewriteShiftZero },
+  { "and-zext", Expr::And, rewriteAndZExt },
+
+  { "extract-zext", Expr::Extract, rewriteExtractZExt },
+  { "extract-sext", Expr::Extract, rewriteExtractSExt },
+  { "extract-extract", Expr::Extract, rewriteExtractExtract },
+  { "zext-zext", Expr::ZExt, rewriteZExtZExt },
+  { "sext-sext", Expr::SExt, rewriteSExtSExt },
+  { "concat-zero", Expr::Concat, rewriteConcatZero },
+  { "concat-extracts", Expr::Concat, rewriteConcatExtracts },
+
+  { "select-same", Expr::Select, rewriteSelectSame },
+  { "select-bool", Expr::Select, rewriteSelectBool },
+  { "select-not-cond", Expr::Select, rewriteSelectNotCond },
+  { "select-nested", Expr::Select, rewriteSelectNested },
+  LIFT_SELECT(Add, "add"),
+  LIFT_SELECT(Sub, "sub"),
+  LIFT_SELECT(Mul, "mul"),
+  LIFT_SELECT(And, "and"),
+  LIFT_SELECT(Or, "or"),
+  LIFT_SELECT(Xor, "xor"),
+  LIFT_SELECT(Shl, "shl"),
+  LIFT_SELECT(LShr, "lshr"),
+  LIFT_SELECT(AShr, "ashr"),
+  LIFT_SELECT(Eq, "eq"),
+  LIFT_SELECT(Ult, "ult"),
+  LIFT_SELECT(Ule, "ule"),
+  LIFT_SELECT(Slt, "slt"),
+  LIFT_SELECT(Sle, "sle"),
+
+  { "add-self", Expr::Add, rewriteAddSelf },
+  { "mul-pow2", Expr::Mul, rewriteMulPow2 },
+  { "udiv-pow2", Expr::UDiv, rewriteUDivPow2 },
+  { "urem-pow2", Expr::URem, rewriteURemPow2 },
+  { "ne-to-eq", Expr::Ne, rewriteNe },
+  { "ugt-to-ult", Expr::Ugt, rewriteUgt },
+  { "uge-to-ule", Expr::Uge, rewriteUge },
+  { "sgt-to-slt", Expr::Sgt, rewriteSgt },
+  { "sge-to-sle", Expr::Sge, rewriteSge },
+  { "ult-bound", Expr::Ult, rewriteUltBound },
+  { "ule-bound", Expr::Ule, rewriteUleBound },
+};
+
+#undef LIFT_SELECT
+
+static const unsigned NumRules = sizeof(Rules) / sizeof(Rules[0]);
+
+/// RuleHits - How often each rule applied, indexed like Rules.
+static uint64_t RuleHits[NumRules];
+
+namespace {
+  class RewritingExprBuilder : public ExprBuilder {
+    ExprBuilder *Base;
+
+    /// RulesByKind - The enabled rules for each kind, in table order.
+    std::vector<unsigned> RulesByKind[Expr::LastKind + 1];
+
+    ref<Expr> rewrite(Expr::Kind K, const Operands &Ops) {
+      const std::vector<unsigned> &KindRules = RulesByKind[K];
+      for (unsigned i = 0, e = KindRules.size(); i != e; ++i) {
+        ref<Expr> Res = Rules[KindRules[i]].Apply(*this, Ops);
+        if (!Res.isNull()) {
+          ++RuleHits[KindRules[i]];
+          return Res;
+        }
+      }
+      return 0;
+    }
+
+  public:
+    RewritingExprBuilder(ExprBuilder *_Base) : Base(_Base) {
+      for (unsigned i = 0; i != NumRules; ++i)
+        if (std::find(DisableRewrite.begin(), DisableRewrite.end(),
+                      Rules[i].Name) == DisableRewrite.end())
+          RulesByKind[Rules[i].Kind].push_back(i);
+    }
+    ~RewritingExprBuilder() { delete Base; }
+
+    virtual ref<Expr> Constant(const llvm::APInt &Value) {
+      return Base->Constant(Value);
+    }
+
+    virtual ref<Expr> NotOptimized(const ref<Expr> &Index) {
+      return Base->NotOptimized(Index);
+    }
+
+    virtual ref<Expr> Read(const UpdateList &Updates,
+                           const ref<Expr> &Index) {
+      return Base->Read(Updates, Index);
+    }
+
+    virtual ref<Expr> Select(const ref<Expr> &Cond,
+                             const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      ref<Expr> Res = rewrite(Expr::Select, Operands(Cond, LHS, RHS));
+      return Res.isNull() ? Base->Select(Cond, LHS, RHS) : Res;
+    }
+
+    virtual ref<Expr> Concat(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      ref<Expr> Res = rewrite(Expr::Concat, Operands(LHS, RHS));
+      return Res.isNull() ? Base->Concat(LHS, RHS) : Res;
+    }
+
+    virtual ref<Expr> Extract(const ref<Expr> &LHS,
+                              unsigned Offset, Expr::Width W) {
+      if (W == LHS->getWidth())
+        return LHS;
+      if (isa<ConstantExpr>(LHS))
+        return Base->Extract(LHS, Offset, W);
+      ref<Expr> Res = rewrite(Expr::Extract, Operands(LHS, 0, 0, Offset, W));
+      return Res.isNull() ? Base->Extract(LHS, Offset, W) : Res;
+    }
+
+    virtual ref<Expr> ZExt(const ref<Expr> &LHS, Expr::Width W) {
+      if (W == LHS->getWidth())
+        return LHS;
+      if (W < LHS->getWidth())
+        return Extract(LHS, 0, W);
+      if (isa<ConstantExpr>(LHS))
+        return Base->ZExt(LHS, W);
+      ref<Expr> Res = rewrite(Expr::ZExt, Operands(LHS, 0, 0, 0, W));
+      return Res.isNull() ? Base->ZExt(LHS, W) : Res;
+    }
+
+    virtual ref<Expr> SExt(const ref<Expr> &LHS, Expr::Width W) {
+      if (W == LHS->getWidth())
+        return LHS;
+      if (W < LHS->getWidth())
+        return Extract(LHS, 0, W);
+      if (isa<ConstantExpr>(LHS))
+        return Base->SExt(LHS, W);
+      ref<Expr> Res = rewrite(Expr::SExt, Operands(LHS, 0, 0, 0, W));
+      return Res.isNull() ? Base->SExt(LHS, W) : Res;
+    }
+
+    virtual ref<Expr> Not(const ref<Expr> &LHS) {
+      ref<Expr> Res = rewrite(Expr::Not, Operands(LHS));
+      return Res.isNull() ? Base->Not(LHS) : Res;
+    }
+
+#define REWRITE_BINARY(_kind)                                            \
+    virtual ref<Expr> _kind(const ref<Expr> &LHS, const ref<Expr> &RHS) { \
+      if (isa<ConstantExpr>(LHS) && isa<ConstantExpr>(RHS))              \
+        return Base->_kind(LHS, RHS);                                    \
+      ref<Expr> Res = rewrite(Expr::_kind, Operands(LHS, RHS));          \
+      return Res.isNull() ? Base->_kind(LHS, RHS) : Res;                 \
+    }
+
+    REWRITE_BINARY(Add)
+    REWRITE_BINARY(Sub)
+    REWRITE_BINARY(Mul)
+    REWRITE_BINARY(UDiv)
+    REWRITE_BINARY(SDiv)
+    REWRITE_BINARY(URem)
+    REWRITE_BINARY(SRem)
+    REWRITE_BINARY(And)
+    REWRITE_BINARY(Or)
+    REWRITE_BINARY(Xor)
+    REWRITE_BINARY(Shl)
+    REWRITE_BINARY(LShr)
+    REWRITE_BINARY(AShr)
+    REWRITE_BINARY(Eq)
+    REWRITE_BINARY(Ne)
+    REWRITE_BINARY(Ult)
+    REWRITE_BINARY(Ule)
+    REWRITE_BINARY(Ugt)
+    REWRITE_BINARY(Uge)
+    REWRITE_BINARY(Slt)
+    REWRITE_BINARY(Sle)
+    REWRITE_BINARY(Sgt)
+    REWRITE_BINARY(Sge)
+
+#undef REWRITE_BINARY
+  };
+}
+
+ExprBuilder *klee::createRewritingExprBuilder(ExprBuilder *Base) {
+  return new RewritingExprBuilder(Base);
+}
+
+void klee::printExprRewriteStats(llvm::raw_ostream &os) {
+  std::vector<std::pair<uint64_t, unsigned> > Order;
+  uint64_t Total = 0;
+  for (unsigned i = 0; i != NumRules; ++i) {
+    Order.push_back(std::make_pair(RuleHits[i], i));
+    Total += RuleHits[i];
+  }
+  // Most frequent rules first, the others in table order.
+  std::stable_sort(Order.begin(), Order.end(),
+                   [](const std::pair<uint64_t, unsigned> &A,
+                      const std::pair<uint64_t, unsigned> &B) {
+                     return A.first > B.first;
+                   });
+
+  os << "# rule hits\n";
+  for (unsigned i = 0; i != NumRules; ++i)
+    os << Rules[Order[i].second].Name << " " << Order[i].first << "\n";
+  os << "total " << Total << "\n";
+}
@@ -37,45 +37,64 @@
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Support/ErrorHandling.h"
 
-#include <map>
+#include <algorithm>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace klee;
 
+namespace {
+/// Discards everything written to it, keeping only the number of lines.
+class LineCountingStream : public llvm::raw_ostream {
+  uint64_t pos;
+  unsigned lines;
+
+  void write_impl(const char *ptr, size_t size) {
+    pos += size;
+    lines += std::count(ptr, ptr + size, '\n');
+  }
+
+  uint64_t current_pos() const { return pos; }
+
+public:
+  LineCountingStream() : pos(0), lines(0) { SetBuffered(); }
+  ~LineCountingStream() { flush(); }
+
+  /// The (1-based) line the next character is written to.
+  unsigned getLine() const { return lines + 1; }
+};
+
+/// Records the assembly line of every instruction while the module is
+/// printed, without keeping the printed text.
 class InstructionToLineAnnotator : public llvm::AssemblyAnnotationWriter {
+  LineCountingStream &counter;
+  std::vector<std::pair<const Instruction*, unsigned> > &lines;
+
 public:
+  InstructionToLineAnnotator(
+      LineCountingStream &_counter,
+      std::vector<std::pair<const Instruction*, unsigned> > &_lines)
+    : counter(_counter), lines(_lines) {}
+
   void emitInstructionAnnot(const Instruction *i,
                             llvm::formatted_raw_ostream &os) {
-    os << "%%%";
-    os << (uintptr_t) i;
+    os.flush();
+    lines.push_back(std::make_pair(i, counter.getLine()));
   }
 };
-        
+}
+
 static void buildInstructionToLineMap(Module *m,
-                                      std::map<const Instruction*, unsigned> &out) {  
-  InstructionToLineAnnotator a;
-  std::string str;
-  llvm::raw_string_ostream os(str);
-  m->print(os, &a);
-  os.flush();
-  const char *s;
-
-  unsigned line = 1;
-  for (s=str.c_str(); *s; s++) {
-    if (*s=='\n') {
-      line++;
-      if (s[1]=='%' && s[2]=='%' && s[3]=='%') {
-        s += 4;
-        char *end;
-        unsigned long long value = strtoull(s, &end, 10);
-        if (end!=s) {
-          out.insert(std::make_pair((const Instruction*) value, line));
-        }
-        s = end;
-      }
-    }
-  }
+                                      llvm::DenseMap<const Instruction*,
+                                                     unsigned> &out) {
+  std::vector<std::pair<const Instruction*, unsigned> > lines;
+  LineCountingStream counter;
+  InstructionToLineAnnotator a(counter, lines);
+  m->print(counter, &a);
+  counter.flush();
+
+  out.insert(lines.begin(), lines.end());
 }
 
 static std::string getDSPIPath(const DILocation &Loc) {
@@ -106,9 +125,19 @@ bool InstructionInfoTable::getInstructionDebugInfo(const llvm::Instruction *I,
 InstructionInfoTable::InstructionInfoTable(Module *m) 
   : dummyString(""), dummyInfo(0, dummyString, 0, 0) {
   unsigned id = 0;
-  std::map<const Instruction*, unsigned> lineTable;
+  llvm::DenseMap<const Instruction*, unsigned> lineTable;
   buildInstructionToLineMap(m, lineTable);
 
+  // The infos are stored densely, in id order; the references handed out
+  // by getInfo() must stay valid, so reserve up front.
+  unsigned numInstructions = 0;
+  for (Module::iterator fnIt = m->begin(), fn_ie = m->end();
+       fnIt != fn_ie; ++fnIt)
+    for (inst_iterator it = inst_begin(&*fnIt), ie = inst_end(&*fnIt);
+         it != ie; ++it)
+      ++numInstructions;
+  infos.reserve(numInstructions);
+
   for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
        fnIt != fn_ie; ++fnIt) {
     Function *fn = &*fnIt;
@@ -135,9 +164,8 @@ InstructionInfoTable::InstructionInfoTable(Module *m)
       // Update our source level debug information.
       getInstructionDebugInfo(instr, file, line);
 
-      infos.insert(std::make_pair(instr,
-                                  InstructionInfo(id++, *file, line,
-                                                  assemblyLine)));
+      ids.insert(std::make_pair(instr, id));
+      infos.push_back(InstructionInfo(id++, *file, line, assemblyLine));
     }
   }
 }
@@ -166,12 +194,12 @@ unsigned InstructionInfoTable::getMaxID() const {
 
 const InstructionInfo &
 InstructionInfoTable::getInfo(const Instruction *inst) const {
-  std::map<const llvm::Instruction*, InstructionInfo>::const_iterator it = 
-    infos.find(inst);
-  if (it == infos.end())
+  llvm::DenseMap<const llvm::Instruction*, unsigned>::const_iterator it =
+    ids.find(inst);
+  if (it == ids.end())
     llvm::report_fatal_error("invalid instruction, not present in "
                              "initial module!");
-  return it->second;
+  return infos[it->second];
 }
 
 const InstructionInfo &
@@ -19,6 +19,7 @@
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/InstructionInfoTable.h"
 #include "klee/Internal/Support/Debug.h"
+#include "klee/Internal/Support/FileHandling.h"
 #include "klee/Internal/Support/ModuleUtil.h"
 
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -36,6 +37,9 @@
 
 #include "klee/Internal/Module/LLVMPassManager.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Support/Path.h"
@@ -43,7 +47,13 @@
 
 #include <llvm/Transforms/Utils/Cloning.h>
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <unistd.h>
 
 using namespace llvm;
 using namespace klee;
@@ -59,6 +69,13 @@ namespace {
   NoTruncateSourceLines("no-truncate-source-lines",
                         cl::desc("Don't truncate long lines in the output source"));
 
+  cl::opt<std::string>
+  PreparedModuleCache("prepared-module-cache",
+                      cl::desc("Directory in which to cache prepared modules, "
+                               "keyed by their input and the options used. "
+                               "Repeated runs on the same input skip the "
+                               "preparation passes (default=off)"));
+
   cl::opt<bool>
   OutputSource("output-source",
                cl::desc("Write the assembly for the final transformed source"),
@@ -112,6 +129,7 @@ KModule::~KModule() {
 
 namespace llvm {
 extern void Optimize(Module *, const std::string &EntryPoint);
+extern std::string getOptimizeOptionsKey();
 }
 
 // what a hack
@@ -198,8 +216,59 @@ void KModule::addInternalFunction(const char* functionName){
   internalFunctions.insert(internalFunction);
 }
 
-void KModule::prepare(const Interpreter::ModuleOptions &opts,
-                      InterpreterHandler *ih) {
+/// Digest of everything that determines the result of preparing \a m.
+static std::string getPreparedModuleKey(Module *m,
+                                        const Interpreter::ModuleOptions &opts,
+                                        const std::string &intrinsicLibPath) {
+  std::string bitcode;
+  llvm::raw_string_ostream os(bitcode);
+  WriteBitcodeToFile(m, os);
+  os.flush();
+
+  std::ifstream lib(intrinsicLibPath.c_str(), std::ios::binary);
+  std::string libContents((std::istreambuf_iterator<char>(lib)),
+                          std::istreambuf_iterator<char>());
+
+  std::ostringstream options;
+  options << LLVM_VERSION_CODE << ':' << opts.EntryPoint << ':'
+          << opts.Optimize << ':' << opts.CheckDivZero << ':'
+          << opts.CheckOvershift << ':' << (int) SwitchType << ':'
+          << llvm::getOptimizeOptionsKey();
+
+  llvm::MD5 hash;
+  hash.update(bitcode);
+  hash.update(libContents);
+  hash.update(options.str());
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> key;
+  llvm::MD5::stringifyResult(result, key);
+  return key.str().str();
+}
+
+/// Write \a m to \a path. Concurrent runs may race to fill the same
+/// entry, so write to a private file first and rename it into place.
+static void writePreparedModule(Module *m, const std::string &path) {
+  std::string tmpPath = path + "." + llvm::utostr(getpid()) + ".tmp";
+  std::string error;
+  llvm::raw_fd_ostream *os = klee_open_output_file(tmpPath, error);
+  if (!os) {
+    klee_warning("unable to write cached module %s: %s", tmpPath.c_str(),
+                 error.c_str());
+    return;
+  }
+  WriteBitcodeToFile(m, *os);
+  delete os;
+
+  if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+    klee_warning("unable to write cached module %s: %s", path.c_str(),
+                 strerror(errno));
+    unlink(tmpPath.c_str());
+  }
+}
+
+void KModule::runPreparationPasses(const Interpreter::ModuleOptions &opts,
+                                   const std::string &intrinsicLibPath) {
   // Inject checks prior to optimization... we also perform the
   // invariant transformations that we will end up doing later so that
   // optimize is seeing what is as close as possible to the final
@@ -231,18 +300,7 @@ void KModule::prepare(const Interpreter::ModuleOptions &opts,
   // this to be linked in, it makes low level debugging much more
   // annoying.
 
-  SmallString<128> LibPath(opts.LibraryDir);
-  llvm::sys::path::append(LibPath,
-      "kleeRuntimeIntrinsic.bc"
-    );
-  module = linkWithLibrary(module, LibPath.str());
-
-  // Add internal functions which are not used to check if instructions
-  // have been already visited
-  if (opts.CheckDivZero)
-    addInternalFunction("klee_div_zero_check");
-  if (opts.CheckOvershift)
-    addInternalFunction("klee_overshift_check");
+  module = linkWithLibrary(module, intrinsicLibPath);
 
 
   // Needs to happen after linking (since ctors/dtors can be modified)
@@ -275,6 +333,51 @@ void KModule::prepare(const Interpreter::ModuleOptions &opts,
   if (!operandTypeCheckPass->checkPassed()) {
     klee_error("Unexpected instruction operand types detected");
   }
+}
+
+void KModule::prepare(const Interpreter::ModuleOptions &opts,
+                      InterpreterHandler *ih) {
+  SmallString<128> LibPath(opts.LibraryDir);
+  llvm::sys::path::append(LibPath,
+      "kleeRuntimeIntrinsic.bc"
+    );
+
+  // The prepared module only depends on the input module, the runtime
+  // library and the options used, so it can be reused across runs.
+  Module *cached = 0;
+  std::string cachePath;
+  if (!PreparedModuleCache.empty()) {
+    SmallString<128> CachePath(PreparedModuleCache);
+    llvm::sys::path::append(CachePath,
+                            getPreparedModuleKey(module, opts, LibPath.str().str()) +
+                            ".bc");
+    cachePath = CachePath.str().str();
+
+    if (llvm::sys::fs::exists(cachePath)) {
+      std::string error;
+      cached = loadModule(module->getContext(), cachePath, error);
+      if (!cached)
+        klee_warning("unable to load cached module %s: %s", cachePath.c_str(),
+                     error.c_str());
+    }
+  }
+
+  if (cached) {
+    klee_message("Using cached prepared module %s", cachePath.c_str());
+    delete module;
+    module = cached;
+  } else {
+    runPreparationPasses(opts, LibPath.str().str());
+    if (!cachePath.empty())
+      writePreparedModule(module, cachePath);
+  }
+
+  // Add internal functions which are not used to check if instructions
+  // have been already visited
+  if (opts.CheckDivZero)
+    addInternalFunction("klee_div_zero_check");
+  if (opts.CheckOvershift)
+    addInternalFunction("klee_overshift_check");
 
   // Write out the .ll assembly file. We truncate long lines to work
   // around a kcachegrind parsing bug (it puts them on new lines), so
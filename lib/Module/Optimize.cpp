@@ -14,6 +14,7 @@
 // This file implements all optimization of the linked module for llvm-ld.
 //
 //===----------------------------------------------------------------------===//
+#include <sstream>
 #include <vector>
 
 #include "Optimize.h"
@@ -472,4 +473,16 @@ void Optimize(Module *M, const std::string &EntryPoint) {
   Passes.run(*M);
 }
 
+/// getOptimizeOptionsKey - Return a string that identifies the settings of
+/// all the options above which change the result of Optimize.
+std::string getOptimizeOptionsKey() {
+  std::ostringstream key;
+  key << O1 << DisableInline << DisableOptimizations << DisableInternalize
+      << DisableIntstrComb << DisableMemToReg << DisableSReplAggr
+      << DisableStripDP << DisableIPCA << Strip << StripDebug;
+  for (unsigned i = 0; i < OptType.size(); i++)
+    key << ',' << (int) OptType[i];
+  return key.str();
+}
+
 }
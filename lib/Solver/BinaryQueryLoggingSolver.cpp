@@ -0,0 +1,135 @@
+//===-- BinaryQueryLoggingSolver.cpp --------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "QueryLoggingSolver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Internal/System/Time.h"
+#include "klee/util/ExprBinaryLog.h"
+
+using namespace klee;
+using namespace klee::util;
+
+/// BinaryQueryLoggingSolver - Logs queries in the binary format of
+/// ExprBinaryWriter. Unlike the text loggers, the query is not
+/// printed before it is known whether it will be logged, and shared
+/// subexpressions are written only once per log.
+class BinaryQueryLoggingSolver : public SolverImpl {
+  Solver *solver;
+  llvm::raw_ostream *os;
+  ExprBinaryWriter writer;
+  int minQueryTimeToLog; // see QueryLoggingSolver
+
+  bool shouldLog(double time) {
+    if (minQueryTimeToLog != 0 &&
+        static_cast<int>(time * 1000) <= minQueryTimeToLog)
+      return false;
+    // a negative threshold means only log the queries which timed out
+    return minQueryTimeToLog >= 0 ||
+           solver->impl->getOperationStatusCode() == SOLVER_RUN_STATUS_TIMEOUT;
+  }
+
+  void log(BinaryQueryRecord &record, const Query &query, double startTime,
+           bool success) {
+    double time = getWallTime() - startTime;
+    if (!shouldLog(time))
+      return;
+    record.constraints.assign(query.constraints.begin(),
+                              query.constraints.end());
+    record.success = success;
+    record.time = static_cast<uint64_t>(time * 1000000);
+    writer.writeQuery(record);
+  }
+
+public:
+  BinaryQueryLoggingSolver(Solver *_solver, std::string path,
+                           int queryTimeToLog)
+      : solver(_solver), os(QueryLoggingSolver::openLogFile(path, true)),
+        writer(*os), minQueryTimeToLog(queryTimeToLog) {
+    assert(0 != solver);
+    writer.writeHeader();
+  }
+
+  virtual ~BinaryQueryLoggingSolver() {
+    delete solver;
+    delete os;
+  }
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    double startTime = getWallTime();
+    bool success = solver->impl->computeTruth(query, isValid);
+    BinaryQueryRecord record;
+    record.kind = BinaryQueryRecord::Truth;
+    record.expr = query.expr;
+    record.result = success && isValid;
+    log(record, query, startTime, success);
+    return success;
+  }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    double startTime = getWallTime();
+    bool success = solver->impl->computeValidity(query, result);
+    BinaryQueryRecord record;
+    record.kind = BinaryQueryRecord::Validity;
+    record.expr = query.expr;
+    record.result = success ? result : 0;
+    log(record, query, startTime, success);
+    return success;
+  }
+
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    double startTime = getWallTime();
+    bool success = solver->impl->computeValue(query, result);
+    BinaryQueryRecord record;
+    record.kind = BinaryQueryRecord::Value;
+    record.expr = query.expr;
+    if (success)
+      if (ConstantExpr *ce = dyn_cast<ConstantExpr>(result))
+        if (ce->getWidth() <= 64)
+          record.result = ce->getZExtValue();
+    log(record, query, startTime, success);
+    return success;
+  }
+
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    double startTime = getWallTime();
+    bool success =
+        solver->impl->computeInitialValues(query, objects, values, hasSolution);
+    BinaryQueryRecord record;
+    record.kind = BinaryQueryRecord::InitialValues;
+    record.expr = query.expr;
+    record.objects = objects;
+    record.result = success && hasSolution;
+    log(record, query, startTime, success);
+    return success;
+  }
+
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+///
+
+Solver *klee::createBinaryQueryLoggingSolver(Solver *_solver, std::string path,
+                                             int minQueryTimeToLog) {
+  return new Solver(
+      new BinaryQueryLoggingSolver(_solver, path, minQueryTimeToLog));
+}
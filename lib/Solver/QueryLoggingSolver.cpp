@@ -15,9 +15,7 @@
 #include "klee/Internal/Support/ErrorHandling.h"
 #endif
 
-#if LLVM_VERSION_CODE >= LLVM_VERSION(3, 5)
 #include "llvm/Support/FileSystem.h"
-#endif
 
 using namespace klee::util;
 
@@ -33,26 +31,28 @@ llvm::cl::opt<bool> CreateCompressedQueryLog(
 #endif
 }
 
-QueryLoggingSolver::QueryLoggingSolver(Solver *_solver, std::string path,
-                                       const std::string &commentSign,
-                                       int queryTimeToLog)
-    : solver(_solver), os(0), BufferString(""), logBuffer(BufferString),
-      queryCount(0), minQueryTimeToLog(queryTimeToLog), startTime(0.0f),
-      lastQueryTime(0.0f), queryCommentSign(commentSign) {
+llvm::raw_ostream *QueryLoggingSolver::openLogFile(const std::string &path,
+                                                   bool binary) {
+  std::string ErrorInfo;
+  llvm::raw_ostream *os;
 #ifdef HAVE_ZLIB_H
   if (!CreateCompressedQueryLog) {
 #endif
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 6)
     std::error_code ec;
     os = new llvm::raw_fd_ostream(path.c_str(), ec,
-                                  llvm::sys::fs::OpenFlags::F_Text);
+                                  binary ? llvm::sys::fs::OpenFlags::F_None
+                                         : llvm::sys::fs::OpenFlags::F_Text);
     if (ec)
       ErrorInfo = ec.message();
 #elif LLVM_VERSION_CODE >= LLVM_VERSION(3, 5)
     os = new llvm::raw_fd_ostream(path.c_str(), ErrorInfo,
-                                  llvm::sys::fs::OpenFlags::F_Text);
+                                  binary ? llvm::sys::fs::OpenFlags::F_None
+                                         : llvm::sys::fs::OpenFlags::F_Text);
 #else
-    os = new llvm::raw_fd_ostream(path.c_str(), ErrorInfo);
+    os = new llvm::raw_fd_ostream(path.c_str(), ErrorInfo,
+                                  binary ? llvm::sys::fs::F_Binary
+                                         : llvm::sys::fs::F_None);
 #endif
 #ifdef HAVE_ZLIB_H
   } else {
@@ -62,6 +62,16 @@ QueryLoggingSolver::QueryLoggingSolver(Solver *_solver, std::string path,
     klee_error("Could not open file %s : %s", path.c_str(), ErrorInfo.c_str());
   }
 #endif
+  return os;
+}
+
+QueryLoggingSolver::QueryLoggingSolver(Solver *_solver, std::string path,
+                                       const std::string &commentSign,
+                                       int queryTimeToLog)
+    : solver(_solver), os(0), BufferString(""), logBuffer(BufferString),
+      queryCount(0), minQueryTimeToLog(queryTimeToLog), startTime(0.0f),
+      lastQueryTime(0.0f), queryCommentSign(commentSign) {
+  os = openLogFile(path, false);
   assert(0 != solver);
 }
 
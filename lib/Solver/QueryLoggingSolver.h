@@ -58,6 +58,10 @@ protected:
   void flushBufferConditionally(bool writeToFile);
 
 public:
+  /// openLogFile - Open a query log for writing, compressed if requested
+  /// with --compress-query-log.
+  static llvm::raw_ostream *openLogFile(const std::string &path, bool binary);
+
   QueryLoggingSolver(Solver *_solver, std::string path,
                      const std::string &commentSign, int queryTimeToLog);
 
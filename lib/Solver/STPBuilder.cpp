@@ -75,7 +75,8 @@ STPArrayExprHash::~STPArrayExprHash() {
 /***/
 
 STPBuilder::STPBuilder(::VC _vc, bool _optimizeDivides)
-  : vc(_vc), optimizeDivides(_optimizeDivides) {
+  : vc(_vc), constructed(SolverConstructCacheSize),
+    optimizeDivides(_optimizeDivides) {
 
 }
 
@@ -497,17 +498,18 @@ ExprHandle STPBuilder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHash || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap< std::pair<ExprHandle, unsigned> >::iterator it = 
-      constructed.find(e);
-    if (it!=constructed.end()) {
+    std::pair<ExprHandle, unsigned> cached;
+    if (constructed.find(e, cached)) {
+      ++stats::queryConstructCacheHits;
       if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
+        *width_out = cached.second;
+      return cached.first;
     } else {
+      ++stats::queryConstructCacheMisses;
       int width;
       if (!width_out) width_out = &width;
       ExprHandle res = constructActual(e, width_out);
-      constructed.insert(std::make_pair(e, std::make_pair(res, *width_out)));
+      constructed.insert(e, std::make_pair(res, *width_out));
       return res;
     }
   }
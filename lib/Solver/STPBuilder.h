@@ -11,7 +11,9 @@
 #define __UTIL_STPBUILDER_H__
 
 #include "klee/util/ExprHashMap.h"
+#include "klee/util/ExprLRUCache.h"
 #include "klee/util/ArrayExprHash.h"
+#include "klee/CommandLine.h"
 #include "klee/Config/config.h"
 
 #include <vector>
@@ -64,7 +66,8 @@ namespace klee {
 
 class STPBuilder {
   ::VC vc;
-  ExprHashMap< std::pair<ExprHandle, unsigned> > constructed;
+  /// Translations of (non-constant) expressions, kept across queries.
+  ExprLRUCache< std::pair<ExprHandle, unsigned> > constructed;
 
   /// optimizeDivides - Rewrite division and reminders by constants
   /// into multiplies and shifts. STP should probably handle this for
@@ -121,7 +124,8 @@ public:
 
   ExprHandle construct(ref<Expr> e) { 
     ExprHandle res = construct(e, 0);
-    constructed.clear();
+    if (!SolverConstructCacheSize)
+      constructed.clear();
     return res;
   }
 };
@@ -21,6 +21,8 @@ Statistic stats::queryCexCacheHits("QueryCexCacheHits", "QCexHits") ;
 Statistic stats::queryCexCacheMisses("QueryCexCacheMisses", "QCexMisses");
 Statistic stats::queryConstructTime("QueryConstructTime", "QBtime") ;
 Statistic stats::queryConstructs("QueriesConstructs", "QB");
+Statistic stats::queryConstructCacheHits("QueryConstructCacheHits", "QBChits");
+Statistic stats::queryConstructCacheMisses("QueryConstructCacheMisses", "QBCmisses");
 Statistic stats::queryCounterexamples("QueriesCEX", "Qcex");
 Statistic stats::queryTime("QueryTime", "Qtime");
 
@@ -11,6 +11,7 @@
 #define __UTIL_Z3BUILDER_H__
 
 #include "klee/util/ExprHashMap.h"
+#include "klee/util/ExprLRUCache.h"
 #include "klee/util/ArrayExprHash.h"
 #include "klee/Config/config.h"
 #include <z3.h>
@@ -100,7 +101,9 @@ public:
 };
 
 class Z3Builder {
-  ExprHashMap<std::pair<Z3ASTHandle, unsigned> > constructed;
+  /// Translations of (non-constant) expressions. Unless
+  /// autoClearConstructCache is set, these are kept across queries.
+  ExprLRUCache<std::pair<Z3ASTHandle, unsigned> > constructed;
   Z3ArrayExprHash _arr_hash;
 
 private:
@@ -62,6 +62,57 @@ static void *__concretize_ptr(const void *p);
 static size_t __concretize_size(size_t s);
 static const char *__concretize_string(const char *s);
 
+/* Copies between symbolic file contents and user buffers are done
+   natively by KLEE on the underlying objects when the addresses and
+   length are concrete. Anything else goes through memcpy. */
+static void __copy_file_data(void *dst, const void *src, size_t count) {
+  if (klee_is_symbolic((uintptr_t) dst) ||
+      klee_is_symbolic((uintptr_t) src) ||
+      klee_is_symbolic(count))
+    memcpy(dst, src, count);
+  else
+    klee_posix_copy_file_data(dst, src, count);
+}
+
+static ssize_t __read_disk_file(exe_disk_file_t *df, void *buf,
+                                size_t count, off64_t off) {
+  assert(off >= 0);
+  if (((off64_t)df->size) < off)
+    return 0;
+
+  if (off + count > df->size)
+    count = df->size - off;
+
+  __copy_file_data(buf, df->contents + off, count);
+  return count;
+}
+
+static ssize_t __write_disk_file(exe_disk_file_t *df, const void *buf,
+                                 size_t count, off64_t off) {
+  size_t actual_count = 0;
+  if (off + count <= df->size)
+    actual_count = count;
+  else {
+    if (__exe_env.save_all_writes)
+      assert(0);
+    else {
+      if (off < (off64_t) df->size)
+        actual_count = df->size - off;
+    }
+  }
+
+  if (actual_count)
+    __copy_file_data(df->contents + off, buf, actual_count);
+
+  if (count != actual_count)
+    klee_warning("write() ignores bytes.\n");
+
+  if (df == __exe_fs.sym_stdout)
+    __exe_fs.stdout_writes += actual_count;
+
+  return count;
+}
+
 /* Returns pointer to the file entry for a valid fd */
 static exe_file_t *__get_file(int fd) {
   if (fd>=0 && fd<MAX_FDS) {
@@ -386,19 +437,10 @@ ssize_t read(int fd, void *buf, size_t count) {
     return r;
   }
   else {
-    assert(f->off >= 0);
-    if (((off64_t)f->dfile->size) < f->off)
-      return 0;
-
     /* symbolic file */
-    if (f->off + count > f->dfile->size) {
-      count = f->dfile->size - f->off;
-    }
-    
-    memcpy(buf, f->dfile->contents + f->off, count);
-    f->off += count;
-    
-    return count;
+    ssize_t r = __read_disk_file(f->dfile, buf, count, f->off);
+    f->off += r;
+    return r;
   }
 }
 
@@ -448,30 +490,84 @@ ssize_t write(int fd, const void *buf, size_t count) {
   }
   else {
     /* symbolic file */    
-    size_t actual_count = 0;
-    if (f->off + count <= f->dfile->size)
-      actual_count = count;
-    else {
-      if (__exe_env.save_all_writes)
-	assert(0);
-      else {
-	if (f->off < (off64_t) f->dfile->size)
-	  actual_count = f->dfile->size - f->off;	
-      }
+    __write_disk_file(f->dfile, buf, count, f->off);
+    f->off += count;
+    return count;
+  }
+}
+
+ssize_t __fd_pread(int fd, void *buf, size_t count, off64_t offset) {
+  exe_file_t *f;
+
+  if (count == 0) 
+    return 0;
+
+  if (buf == NULL) {
+    errno = EFAULT;
+    return -1;
+  }
+
+  f = __get_file(fd);
+
+  if (!f) {
+    errno = EBADF;
+    return -1;
+  }
+
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (!f->dfile) {
+    /* concrete file */
+    int r;
+    buf = __concretize_ptr(buf);
+    count = __concretize_size(count);
+    klee_check_memory_access(buf, count);
+    r = syscall(__NR_pread64, f->fd, buf, count, offset);
+
+    if (r == -1) {
+      errno = klee_get_errno();
+      return -1;
     }
-    
-    if (actual_count)
-      memcpy(f->dfile->contents + f->off, buf, actual_count);
-    
-    if (count != actual_count)
-      klee_warning("write() ignores bytes.\n");
+    return r;
+  }
 
-    if (f->dfile == __exe_fs.sym_stdout)
-      __exe_fs.stdout_writes += actual_count;
+  /* symbolic file, the file offset is left unchanged */
+  return __read_disk_file(f->dfile, buf, count, offset);
+}
 
-    f->off += count;
-    return count;
+ssize_t __fd_pwrite(int fd, const void *buf, size_t count, off64_t offset) {
+  exe_file_t *f = __get_file(fd);
+
+  if (!f) {
+    errno = EBADF;
+    return -1;
+  }
+
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (!f->dfile) {
+    /* concrete file */
+    int r;
+    buf = __concretize_ptr(buf);
+    count = __concretize_size(count);
+    klee_check_memory_access(buf, count);
+    r = syscall(__NR_pwrite64, f->fd, buf, count, offset);
+
+    if (r == -1) {
+      errno = klee_get_errno();
+      return -1;
+    }
+    return r;
   }
+
+  /* symbolic file, the file offset is left unchanged */
+  return __write_disk_file(f->dfile, buf, count, offset);
 }
 
 
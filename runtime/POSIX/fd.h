@@ -81,6 +81,8 @@ void klee_init_env(int *argcPtr, char ***argvPtr);
 int __fd_open(const char *pathname, int flags, mode_t mode);
 int __fd_openat(int basefd, const char *pathname, int flags, mode_t mode);
 off64_t __fd_lseek(int fd, off64_t offset, int whence);
+ssize_t __fd_pread(int fd, void *buf, size_t count, off64_t offset);
+ssize_t __fd_pwrite(int fd, const void *buf, size_t count, off64_t offset);
 int __fd_stat(const char *path, struct stat64 *buf);
 int __fd_lstat(const char *path, struct stat64 *buf);
 int __fd_fstat(int fd, struct stat64 *buf);
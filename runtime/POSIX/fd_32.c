@@ -94,6 +94,14 @@ off_t lseek(int fd, off_t off, int whence) {
   return (off_t) __fd_lseek(fd, off, whence);
 }
 
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+  return __fd_pread(fd, buf, count, offset);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return __fd_pwrite(fd, buf, count, offset);
+}
+
 int __xstat(int vers, const char *path, struct stat *buf) {
   struct stat64 tmp;
   int res = __fd_stat(path, &tmp);
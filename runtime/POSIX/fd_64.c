@@ -74,6 +74,14 @@ off64_t lseek(int fd, off64_t offset, int whence) {
   return __fd_lseek(fd, offset, whence);
 }
 
+ssize_t pread(int fd, void *buf, size_t count, off64_t offset) {
+  return __fd_pread(fd, buf, count, offset);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off64_t offset) {
+  return __fd_pwrite(fd, buf, count, offset);
+}
+
 int __xstat(int vers, const char *path, struct stat *buf) {
   return __fd_stat(path, (struct stat64*) buf);
 }
@@ -10,17 +10,23 @@
 /* Straight C for linking simplicity */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "klee/klee.h"
 
 #include "klee/Internal/ADT/KTest.h"
+#include "klee/Internal/ADT/KTestForkServer.h"
 
 static KTest *testData = 0;
 static unsigned testPosition = 0;
@@ -49,6 +55,139 @@ static void report_internal_error(const char *msg, ...) {
   }
 }
 
+static int read_all(int fd, void *buf, size_t count) {
+  char *p = buf;
+  while (count) {
+    ssize_t n = read(fd, p, count);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    count -= n;
+  }
+  return 1;
+}
+
+static int write_all(int fd, const void *buf, size_t count) {
+  const char *p = buf;
+  while (count) {
+    ssize_t n = write(fd, p, count);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    count -= n;
+  }
+  return 1;
+}
+
+/* Read a test of the given size from the shared memory of a fork server,
+   see KTestForkServer.h. */
+static KTest *read_shared_test(int shmFd, uint32_t size) {
+  unsigned char *data, *p, *end;
+  unsigned i;
+  KTest *res;
+  void *shm;
+
+  if (size < 4)
+    return 0;
+  shm = mmap(0, size, PROT_READ, MAP_SHARED, shmFd, 0);
+  if (shm == MAP_FAILED)
+    return 0;
+  /* The test outlives the mapping, which the driver reuses. */
+  data = malloc(size);
+  res = calloc(1, sizeof(*res));
+  if (!data || !res)
+    return 0;
+  memcpy(data, shm, size);
+  munmap(shm, size);
+
+  p = data;
+  end = data + size;
+  memcpy(&res->numObjects, p, 4);
+  p += 4;
+  res->objects = calloc(res->numObjects, sizeof(*res->objects));
+  if (!res->objects)
+    return 0;
+  for (i = 0; i < res->numObjects; ++i) {
+    KTestObject *o = &res->objects[i];
+    uint32_t nameSize;
+    if (end - p < 8)
+      return 0;
+    memcpy(&nameSize, p, 4);
+    memcpy(&o->numBytes, p + 4, 4);
+    p += 8;
+    if ((size_t)(end - p) < (size_t) nameSize + o->numBytes || !nameSize ||
+        p[nameSize - 1])
+      return 0;
+    o->name = (char *) p;
+    o->bytes = p + nameSize;
+    p += nameSize + o->numBytes;
+  }
+  return res;
+}
+
+/* Serve tests to klee-replay --fork-server, see KTestForkServer.h. Only
+   returns in the children, with the test to run in testData. */
+static void run_fork_server(const char *fds) {
+  int ctlFd, statusFd, shmFd;
+  uint32_t msg;
+
+  if (sscanf(fds, "%d,%d,%d", &ctlFd, &statusFd, &shmFd) != 3) {
+    fprintf(stderr, "KLEE-RUNTIME: invalid %s\n", KTEST_FORK_SERVER_ENV);
+    exit(1);
+  }
+
+  /* Don't let every child repeat the output buffered so far. */
+  fflush(NULL);
+
+  msg = KTEST_FORK_SERVER_HELLO;
+  if (!write_all(statusFd, &msg, sizeof msg))
+    exit(1);
+
+  for (;;) {
+    uint32_t size;
+    int status;
+    pid_t pid;
+
+    if (!read_all(ctlFd, &size, sizeof size))
+      exit(0);
+
+    pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      exit(1);
+    }
+    if (pid == 0) {
+      close(ctlFd);
+      close(statusFd);
+      unsetenv(KTEST_FORK_SERVER_ENV);
+      testData = read_shared_test(shmFd, size);
+      close(shmFd);
+      if (!testData) {
+        fprintf(stderr, "KLEE-RUNTIME: unable to read test from fork server\n");
+        exit(1);
+      }
+      return;
+    }
+
+    msg = pid;
+    if (!write_all(statusFd, &msg, sizeof msg))
+      exit(1);
+    while (waitpid(pid, &status, 0) < 0) {
+      if (errno != EINTR) {
+        perror("waitpid");
+        exit(1);
+      }
+    }
+    msg = status;
+    if (!write_all(statusFd, &msg, sizeof msg))
+      exit(1);
+  }
+}
+
 void klee_make_symbolic(void *array, size_t nbytes, const char *name) {
   static int rand_init = -1;
 
@@ -77,6 +216,12 @@ void klee_make_symbolic(void *array, size_t nbytes, const char *name) {
     return;
   }
 
+  if (!testData) {
+    char *fds = getenv(KTEST_FORK_SERVER_ENV);
+    if (fds)
+      run_fork_server(fds);
+  }
+
   if (!testData) {
     char tmp[256];
     char *name = getenv("KTEST_FILE");
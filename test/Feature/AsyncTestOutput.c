@@ -0,0 +1,26 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --async-test-output --write-kqueries %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | grep -c ktest | grep 4
+// RUN: ls %t.klee-out | grep -c kquery | grep 4
+// RUN: ls %t.klee-out | grep -c assert.err | grep 1
+// RUN: %ktest-tool --write-ints %t.klee-out/test*.ktest | FileCheck --check-prefix=CHECK-KTEST %s
+
+#include <assert.h>
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  if (x == 1)
+    return 1;
+  if (x == 2)
+    return 2;
+  assert(x != 3);
+  return 0;
+}
+
+// CHECK: KLEE: done: generated tests = 4
+// CHECK-KTEST-DAG: object    0: data: 1{{$}}
+// CHECK-KTEST-DAG: object    0: data: 2{{$}}
+// CHECK-KTEST-DAG: object    0: data: 3{{$}}
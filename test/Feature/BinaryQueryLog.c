@@ -0,0 +1,30 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --use-cex-cache=false --use-query-log=all:kquery,all:binary,solver:kquery,solver:binary %t1.bc 2> %t2.log
+// RUN: %kleaver -print-ast %t.klee-out/all-queries.kquery > %t3.log
+// RUN: %kleaver -print-ast %t.klee-out/all-queries.kqb > %t4.log
+// RUN: diff %t3.log %t4.log
+// RUN: %kleaver -print-ast %t.klee-out/solver-queries.kquery > %t3.log
+// RUN: %kleaver -print-ast %t.klee-out/solver-queries.kqb > %t4.log
+// RUN: diff %t3.log %t4.log
+// RUN: %kleaver -evaluate %t.klee-out/all-queries.kqb > %t5.log
+// RUN: grep -q "^Query" %t5.log
+
+#include <assert.h>
+
+int table[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+int main() {
+  char buf[4];
+  klee_make_symbolic(buf, sizeof buf);
+
+  table[klee_range(0, 8, "idx.0")] = buf[0];
+  int y = table[klee_range(0, 8, "idx.1")];
+
+  klee_assume(buf[1] == 'b');
+  int x = *((int*) buf);
+  if (x == y)
+    assert(0);
+
+  return 0;
+}
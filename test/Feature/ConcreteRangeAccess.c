@@ -0,0 +1,53 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error %t.bc 2>&1 | FileCheck %s
+
+// Reads and writes which cover both concrete and symbolic bytes, at
+// unaligned offsets and wider than 64 bits.
+
+#include <assert.h>
+
+int main() {
+  unsigned char buf[32], sym[16], s;
+  unsigned long long x;
+  unsigned __int128 w;
+  unsigned i;
+
+  for (i = 0; i != sizeof buf; ++i)
+    buf[i] = 0xAB;
+  klee_make_symbolic(&s, sizeof s, "s");
+  buf[13] = s;
+
+  // A read spanning concrete bytes on both sides of a symbolic one.
+  x = *(unsigned long long *)(buf + 9);
+  assert(x == (0xABABAB00ABABABABULL | (unsigned long long)s << 32));
+  w = *(unsigned __int128 *)(buf + 1);
+  assert((unsigned char)(w >> 96) == s);
+  assert((unsigned char)(w >> 88) == 0xAB && (unsigned char)(w >> 120) == 0xAB);
+
+  // A symbolic write into a concrete range leaves its neighbours alone.
+  *(unsigned long long *)(buf + 19) = 0x1122334455667700ULL | s;
+  assert(buf[18] == 0xAB && buf[19] == s && buf[20] == 0x77 &&
+         buf[26] == 0x11 && buf[27] == 0xAB);
+
+  // A concrete write wider than 64 bits.
+  w = (unsigned __int128)0x0102030405060708ULL << 64 | 0x090A0B0C0D0E0F10ULL;
+  *(unsigned __int128 *)(buf + 14) = w;
+  assert(buf[14] == 0x10 && buf[21] == 0x09 && buf[22] == 0x08 &&
+         buf[29] == 0x01 && buf[30] == 0xAB);
+  assert(*(unsigned __int128 *)(buf + 14) == w);
+  assert(buf[13] == s);
+
+  // A concrete long double over symbolic bytes makes exactly those bytes
+  // concrete.
+  klee_make_symbolic(sym, sizeof sym, "sym");
+  *(long double *)(sym + 3) = 1.5L;
+  assert(*(long double *)(sym + 3) == 1.5L);
+  assert(!klee_is_symbolic(sym[3]) && !klee_is_symbolic(sym[12]));
+  assert(klee_is_symbolic(sym[2]) && klee_is_symbolic(sym[13]));
+
+  return 0;
+}
+
+// CHECK-NOT: ASSERTION FAIL
+// CHECK: KLEE: done: completed paths = 1
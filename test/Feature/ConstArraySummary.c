@@ -0,0 +1,42 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --use-query-log=all:kquery %t.bc 2>&1 | FileCheck %s
+// RUN: not grep const_arr %t.klee-out/all-queries.kquery
+
+// Lookups at symbolic indices into constant tables are folded into
+// expressions over the index, so no query reads a constant array.
+
+#include <assert.h>
+
+int main() {
+  unsigned char kind[64], grade[64], times3[200];
+  unsigned char c, k;
+  unsigned i;
+
+  for (i = 0; i < 64; ++i) {
+    kind[i] = i < 10 ? 0 : i < 40 ? 1 : 2;
+    grade[i] = i * i / 16;
+  }
+  for (i = 0; i < 200; ++i)
+    times3[i] = 3 * i + 7;
+
+  klee_make_symbolic(&c, sizeof c, "c");
+  klee_make_symbolic(&k, sizeof k, "k");
+  if (c >= 64 || k >= 200)
+    return 0;
+
+  // Few distinct values: a chain of selects.
+  if (kind[c] == 2)
+    assert(c >= 40);
+  // Monotonic: a range of indices.
+  if (grade[c] < 50)
+    assert(c <= 28);
+  // Linear: arithmetic on the index.
+  if (times3[k] == 100)
+    assert(k == 31);
+
+  return 0;
+}
+
+// CHECK-NOT: ASSERTION FAIL
+// CHECK: KLEE: done: generated tests =
@@ -0,0 +1,34 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | grep -c readonly.err | grep 1
+
+#include <stdio.h>
+
+static const unsigned char table[256] = {
+  ['a'] = 1, ['e'] = 1, ['i'] = 1, ['o'] = 1, ['u'] = 1
+};
+
+static const char greeting[] = "hello";
+
+int main() {
+  unsigned char c;
+  klee_make_symbolic(&c, sizeof(c), "c");
+
+  // Native code sees the contents of constant globals.
+  printf("%s\n", greeting);
+  // CHECK: hello
+
+  // Symbolic reads of the table.
+  if (table[c])
+    printf("vowel\n");
+  else
+    printf("other\n");
+
+  // Writing to a constant global is an error.
+  if (c == 'x')
+    *(char *) &greeting[0] = 'j';
+  // CHECK: memory error: object read only
+
+  return 0;
+}
@@ -0,0 +1,20 @@
+// RUN: %llvmgcc %s -g -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --stop-after-n-instructions=200 --dump-states-max-time=1e-9 %t1.bc 2>&1 | FileCheck %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --stop-after-n-instructions=200 --dump-states-max-time=3600 %t1.bc 2>&1 | FileCheck --check-prefix=CHECK-ALL %s
+
+int main(int argc, char** argv) {
+  char buf[8];
+  int i, n = 0;
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+  for (i = 0; i < 8; i++)
+    if (buf[i])
+      n++;
+  return n;
+}
+// CHECK: halting execution, dumping remaining states
+// CHECK: states terminated without a test case
+
+// CHECK-ALL: halting execution, dumping remaining states
+// CHECK-ALL-NOT: states terminated without a test case
@@ -0,0 +1,24 @@
+// RUN: %llvmgcc %s -emit-llvm -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --search=generational %t.bc 2>&1 | FileCheck %s
+// RUN: FileCheck -check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+// RUN: ls %t.klee-out | grep -c assert.err | grep 1
+
+#include <assert.h>
+
+int main() {
+  char buf[4];
+  klee_make_symbolic(buf, sizeof buf, "buf");
+
+  // The first input is all zeros; each generation gets one byte closer.
+  if (buf[0] == 'b')
+    if (buf[1] == 'a')
+      if (buf[2] == 'd')
+        if (buf[3] == '!')
+          assert(0 && "bad!");
+  return 0;
+}
+
+// CHECK: ASSERTION FAIL
+// CHECK: KLEE: done: generated tests = 5
+// CHECK-INFO: GenerationalSearcher
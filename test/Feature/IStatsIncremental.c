@@ -0,0 +1,32 @@
+// Check that incremental instruction level statistics add up to the
+// statistics written at exit.
+//
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --istats-incremental --istats-write-interval=0 --istats-write-after-instructions=10 %t1.bc
+// RUN: grep -c "^snapshot:" %t.klee-out/run.istats.delta | grep -v "^[01]$"
+// RUN: %klee-istats export %t.klee-out > %t.istats
+// RUN: FileCheck < %t.istats %s
+// RUN: %klee-istats compact %t.klee-out -o %t.compact
+// RUN: grep -c "^snapshot:" %t.compact | grep "^1$"
+// RUN: %klee-istats export %t.compact | diff - %t.istats
+
+// CHECK: events:
+// CHECK: fn=f
+// CHECK-NEXT: {{[1-9][0-9]*}} {{[1-9][0-9]*}} {{.*}}
+// CHECK: fn=main
+
+int f(int x) {
+  int i, sum = 0;
+  for (i = 0; i < 20; ++i)
+    sum += x;
+  return sum;
+}
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  if (x > 10)
+    return f(x);
+  return 0;
+}
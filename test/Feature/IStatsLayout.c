@@ -0,0 +1,30 @@
+// Check that instruction level statistics are written with both storage
+// layouts, and when every statistic is kept per instruction.
+//
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --istats-layout=rows %t1.bc
+// RUN: FileCheck < %t.klee-out/run.istats %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --istats-layout=columns %t1.bc
+// RUN: FileCheck < %t.klee-out/run.istats %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --istats-index-all %t1.bc
+// RUN: FileCheck < %t.klee-out/run.istats %s
+
+// CHECK: event: I : Instructions
+// CHECK: fn=f
+// CHECK-NEXT: {{[1-9][0-9]*}} {{[1-9][0-9]*}} {{.*}}
+// CHECK: fn=main
+
+int f(int x) {
+  if (x > 10)
+    return x - 10;
+  return x;
+}
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  return f(x);
+}
@@ -0,0 +1,42 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: rm -rf %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out2 --implied-value-concretization=false %t.bc 2>&1 | FileCheck -check-prefix=CHECK-OFF %s
+
+#include <stdio.h>
+
+int main() {
+  unsigned char c;
+  unsigned short s;
+  char buf[4], copy[4];
+  unsigned i;
+
+  klee_make_symbolic(&c, sizeof c, "c");
+  klee_make_symbolic(&s, sizeof s, "s");
+  klee_make_symbolic(buf, sizeof buf, "buf");
+  for (i = 0; i < sizeof buf; ++i)
+    copy[i] = buf[i];
+
+  if (c == 42 && !klee_is_symbolic(c))
+    printf("c is concrete\n");
+
+  // Both bytes are fixed through the addition.
+  if (s + 1 == 0xBEF0 && !klee_is_symbolic(s))
+    printf("s is concrete\n");
+
+  // The copy holding the fixed byte is concretized as well, only there.
+  if (buf[1] == 'x' && !klee_is_symbolic(buf[1]) &&
+      !klee_is_symbolic(copy[1]) && klee_is_symbolic(copy[0]))
+    printf("buf[1] is concrete\n");
+
+  return 0;
+}
+
+// CHECK-DAG: c is concrete
+// CHECK-DAG: s is concrete
+// CHECK-DAG: buf[1] is concrete
+// CHECK-DAG: KLEE: done: generated tests = 8
+
+// CHECK-OFF-NOT: is concrete
+// CHECK-OFF: KLEE: done: generated tests = 8
@@ -0,0 +1,29 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-replay
+// RUN: %klee --output-dir=%t.klee-out --ktest-archive --posix-runtime %t.bc --sym-arg 1
+// RUN: test -f %t.klee-out/tests.ktar
+// RUN: test ! -f %t.klee-out/test000001.ktest
+// RUN: %ktest-tool %t.klee-out/tests.ktar | FileCheck --check-prefix=CHECK-KTEST %s
+// RUN: %klee --output-dir=%t.klee-replay --replay-ktest-dir=%t.klee-out --posix-runtime %t.bc 2>&1 | FileCheck --check-prefix=CHECK-REPLAY %s
+// RUN: %cc %s -O0 -o %t.native
+// RUN: %klee-replay %t.native %t.klee-out/tests.ktar 2>&1 | FileCheck --check-prefix=CHECK-NATIVE %s
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+  if (argc > 1 && argv[1][0] == 'a')
+    printf("Yes\n");
+  else
+    printf("No\n");
+  return 0;
+}
+
+// CHECK-KTEST: ktest file : '{{.*}}tests.ktar:1'
+// CHECK-KTEST: ktest file : '{{.*}}tests.ktar:2'
+
+// CHECK-REPLAY: (2/2)
+
+// CHECK-NATIVE-DAG: TEST CASE: {{.*}}tests.ktar:1
+// CHECK-NATIVE-DAG: TEST CASE: {{.*}}tests.ktar:2
+// CHECK-NATIVE-DAG: Yes
+// CHECK-NATIVE-DAG: No
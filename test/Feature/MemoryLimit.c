@@ -16,6 +16,11 @@
 // RUN: not grep -q "DONE" %t.big.log
 // RUN: grep "WARNING: killing 1 states (over memory cap)" %t.klee-out/warnings.txt
 
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --max-memory=20 --max-memory-eviction=random %t.little.bc > %t.random.log
+// RUN: not grep -q "DONE" %t.random.log
+// RUN: grep "WARNING: killing 1 states (over memory cap)" %t.klee-out/warnings.txt
+
 #include <stdlib.h>
 #include <stdio.h>
 
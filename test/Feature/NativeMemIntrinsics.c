@@ -0,0 +1,52 @@
+// RUN: %llvmgcc -emit-llvm -g -c %s -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: rm -rf %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out2 --native-mem-intrinsics=false %t.bc 2>&1 | FileCheck %s
+
+#include <assert.h>
+#include <string.h>
+
+#define N 8192
+
+char a[N], b[N];
+
+int main() {
+  unsigned i, n;
+
+  memset(a, 'x', N);
+  memcpy(b, a, N);
+  for (i = 0; i < N; i += 512)
+    assert(b[i] == 'x');
+
+  // Overlapping move.
+  for (i = 0; i < 16; ++i)
+    a[i] = i;
+  memmove(a + 1, a, 15);
+  assert(a[0] == 0 && a[1] == 0 && a[15] == 14);
+
+  // Symbolic contents are carried along.
+  char s[4];
+  klee_make_symbolic(s, sizeof(s), "s");
+  memcpy(b + 100, s, sizeof(s));
+  if (b[102] == 'q')
+    assert(s[2] == 'q');
+
+  // Symbolic, bounded length.
+  char c[16];
+  memset(c, 0, sizeof(c));
+  klee_make_symbolic(&n, sizeof(n), "n");
+  klee_assume(n <= 16);
+  memset(c, 'y', n);
+  if (n > 3)
+    assert(c[3] == 'y');
+  else
+    assert(c[3] == 0);
+
+  // Out of bounds copies are still reported.
+  if (n == 16)
+    memcpy(c + 1, a, n);
+  // CHECK: memory error: out of bound pointer
+
+  return 0;
+}
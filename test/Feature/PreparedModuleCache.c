@@ -0,0 +1,20 @@
+// RUN: %llvmgcc -emit-llvm -g -c %s -o %t.bc
+// RUN: rm -rf %t.cache %t.klee-out %t.klee-out2 %t.klee-out3
+// RUN: mkdir %t.cache
+// RUN: %klee --output-dir=%t.klee-out --prepared-module-cache=%t.cache %t.bc 2>&1 | FileCheck --check-prefix=FIRST %s
+// RUN: %klee --output-dir=%t.klee-out2 --prepared-module-cache=%t.cache %t.bc 2>&1 | FileCheck --check-prefix=SECOND %s
+// RUN: %klee --output-dir=%t.klee-out3 --prepared-module-cache=%t.cache --disable-inlining %t.bc 2>&1 | FileCheck --check-prefix=FIRST %s
+
+// FIRST-NOT: Using cached prepared module
+// FIRST: KLEE: done: completed paths = 2
+
+// SECOND: Using cached prepared module
+// SECOND: KLEE: done: completed paths = 2
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  if (x > 10)
+    return 1;
+  return 0;
+}
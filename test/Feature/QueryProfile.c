@@ -0,0 +1,25 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --query-profile --query-profile-log %t1.bc
+// RUN: FileCheck -check-prefix=CHECK-SITES < %t.klee-out/query-sites.prof %s
+// RUN: FileCheck -check-prefix=CHECK-STACKS < %t.klee-out/query-stacks.folded %s
+// RUN: FileCheck -check-prefix=CHECK-LOG < %t.klee-out/query-profile.log %s
+
+// CHECK-SITES: # time(s) queries
+// CHECK-SITES: QueryProfile.c:16 {{[0-9]+}} check
+
+// CHECK-STACKS: main;check;[solver] {{[0-9]+}}
+
+// CHECK-LOG: {{evaluate|mustBeTrue}} solver {{[0-9]+}} {{.*}}QueryProfile.c:16 {{[0-9]+}} check
+
+int check(int x) {
+  if (x * x == 49)
+    return 1;
+  return 0;
+}
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  return check(x);
+}
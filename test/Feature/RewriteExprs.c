@@ -0,0 +1,21 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --rewrite-exprs %t.bc 2>&1 | FileCheck %s
+// RUN: FileCheck -check-prefix=CHECK-STATS -input-file=%t.klee-out/rewrites.stats %s
+
+#include <assert.h>
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof x, "x");
+
+  // Built as x >> 4 and x & 15.
+  if (x / 16 == 3 && x % 16 == 5)
+    assert(x == 53);
+  return 0;
+}
+
+// CHECK-NOT: ASSERTION FAIL
+// CHECK: KLEE: done: generated tests = 3
+// CHECK-STATS-DAG: udiv-pow2 {{[1-9]}}
+// CHECK-STATS-DAG: urem-pow2 {{[1-9]}}
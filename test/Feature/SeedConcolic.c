@@ -0,0 +1,32 @@
+// RUN: %llvmgcc -emit-llvm -c -g -DMAKE_SEED %s -o %t.seed.bc
+// RUN: rm -rf %t.klee-seed
+// RUN: %klee --output-dir=%t.klee-seed %t.seed.bc
+// RUN: test -f %t.klee-seed/test000001.ktest
+
+// RUN: %llvmgcc -emit-llvm -c -g %s -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --seed-concolic --seed-out %t.klee-seed/test000001.ktest %t.bc 2>&1 | FileCheck %s
+
+#include <stdio.h>
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof x, "x");
+#ifdef MAKE_SEED
+  klee_assume(x == 42);
+#else
+  // The seed follows the true side; the false side is checked later.
+  if (x == 42)
+    printf("forty-two\n");
+  else
+    printf("other\n");
+
+  // The true side is infeasible for the seeded state, and dropped
+  // once it is checked.
+  if (x > 100)
+    printf("big\n");
+#endif
+  return 0;
+}
+
+// CHECK: KLEE: done: generated tests = 3
@@ -0,0 +1,56 @@
+// RUN: %llvmgcc -emit-llvm -g -c %s -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --update-list-compaction-threshold=4 --const-array-summary=false --use-query-log=all:kquery %t.bc > %t.log 2>&1
+// RUN: grep -q "^ok$" %t.log
+// RUN: not grep "ASSERTION FAIL" %t.log
+// RUN: FileCheck -input-file=%t.klee-out/all-queries.kquery %s
+// RUN: rm -rf %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out2 --update-list-compaction-threshold=0 --const-array-summary=false --use-query-log=all:kquery %t.bc > %t2.log 2>&1
+// RUN: grep -q "^ok$" %t2.log
+// RUN: not grep "ASSERTION FAIL" %t2.log
+// RUN: not grep const_arr2 %t.klee-out2/all-queries.kquery
+
+// The first constant array is made of the initial contents of buf. Further
+// ones only come from compaction rebasing the update list of buf onto its
+// current contents, instead of reading through all the flushed writes.
+// CHECK: array const_arr2[8]
+
+#include <assert.h>
+#include <stdio.h>
+
+int main() {
+  unsigned char buf[8];
+  unsigned i, j, k;
+  unsigned char v;
+
+  klee_make_symbolic(&k, sizeof(k), "k");
+  klee_make_symbolic(&v, sizeof(v), "v");
+  klee_assume(k < 8);
+
+  // Every byte is rewritten concretely between symbolic reads, so each read
+  // flushes all of them onto the update list.
+  for (j = 0; j < 4; ++j) {
+    for (i = 0; i < 8; ++i)
+      buf[i] = i * i + j;
+    if (buf[k] != k * k + j)
+      assert(0 && "unexpected value");
+  }
+
+  for (i = 0; i < 8; ++i)
+    buf[i] = i;
+
+  // Symbolic writes interleaved with full concrete rewrites, so that the
+  // update list is both folded and rebased.
+  for (j = 0; j < 4; ++j) {
+    buf[k] = v;
+    if (k != 2 && buf[(k + 1) % 8] != (k + 1) % 8 + j)
+      assert(0 && "unexpected overwrite");
+    for (i = 0; i < 8; ++i)
+      buf[i] = i + j + 1;
+    buf[3] = v;
+  }
+
+  assert(buf[k] == (k == 3 ? v : k + 4));
+  printf("ok\n");
+  return 0;
+}
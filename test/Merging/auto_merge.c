@@ -0,0 +1,29 @@
+// RUN: %llvmgcc -emit-llvm -g -c -o %t.bc %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --auto-merge --debug-log-merge --search=dfs %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | grep -c assert.err | grep 1
+
+// Without merging, the loop below forks 256 paths.
+
+// CHECK: auto merge:
+// CHECK: KLEE: done: generated tests = 2{{$}}
+
+#include <klee/klee.h>
+
+int main(int argc, char** args){
+  char buf[8];
+  int count = 0;
+  int i;
+
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  for (i = 0; i < 8; ++i){
+    if (buf[i] == 'a')
+      ++count;
+  }
+
+  if (count == 8)
+    klee_assert(0);
+
+  return 0;
+}
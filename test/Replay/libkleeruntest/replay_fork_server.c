@@ -0,0 +1,38 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --search=dfs %t.bc
+// RUN: test -f %t.klee-out/test000003.ktest
+
+// Replay all tests with two fork servers of a single binary
+// RUN: %cc %s %libkleeruntest -Wl,-rpath %libkleeruntestdir -o %t_runner
+// RUN: %klee-replay --fork-server --jobs=2 %t_runner %t.klee-out/*.ktest > %t.out 2> %t.err
+// RUN: FileCheck --input-file=%t.out %s
+// RUN: grep -c initialized %t.out | grep 2
+// RUN: FileCheck --input-file=%t.err -check-prefix=STATUS %s
+
+#include "klee/klee.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char** argv) {
+  int x = 0;
+
+  // Printed once by each server, before the first test is read
+  printf("initialized\n");
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  if (x == 0)
+    printf("x is 0\n");
+  else if (x == 1)
+    abort();
+  else
+    printf("x is not 0\n");
+  return 0;
+}
+
+// CHECK-DAG: x is 0
+// CHECK-DAG: x is not 0
+// STATUS-DAG: TEST CASE: {{.*}}test000001.ktest
+// STATUS-DAG: TEST CASE: {{.*}}test000002.ktest
+// STATUS-DAG: TEST CASE: {{.*}}test000003.ktest
+// STATUS-DAG: EXIT STATUS: CRASHED signal 6
@@ -0,0 +1,44 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error --posix-runtime %t.bc --sym-files 1 8 >%t.log
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+#include "klee/klee.h"
+
+int main(int argc, char** argv) {
+  char buf[8], buf2[8];
+
+  int fd = open("A", O_RDWR);
+  if (fd == -1)
+    klee_silent_exit(0);
+
+  // EINVAL offset is negative
+  int x = pread(fd, buf, 1, -1);
+  assert(x == -1 && errno == EINVAL);
+
+  // pread does not move the file offset
+  x = pread(fd, buf, 4, 4);
+  assert(x == 4);
+  assert(lseek(fd, 0, SEEK_CUR) == 0);
+
+  // reads past the end of the file are truncated
+  x = pread(fd, buf2, 8, 6);
+  assert(x == 2);
+
+  x = read(fd, buf2, 8);
+  assert(x == 8);
+  assert(buf[0] == buf2[4] && buf[3] == buf2[7]);
+
+  // pwrite goes to the given offset, read observes it
+  x = pwrite(fd, "ab", 2, 0);
+  assert(x == 2);
+  x = pread(fd, buf, 2, 0);
+  assert(x == 2 && buf[0] == 'a' && buf[1] == 'b');
+
+  return 0;
+}
@@ -23,6 +23,7 @@
 #include "klee/util/ExprVisitor.h"
 #include "klee/util/ExprSMTLIBPrinter.h"
 #include "klee/Internal/Support/PrintVersion.h"
+#include "klee/Internal/System/Time.h"
 
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
@@ -30,7 +31,12 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 
@@ -54,7 +60,8 @@ namespace {
     PrintTokens,
     PrintAST,
     PrintSMTLIBv2,
-    Evaluate
+    Evaluate,
+    Benchmark
   };
 
   static llvm::cl::opt<ToolActions> 
@@ -68,14 +75,36 @@ namespace {
              clEnumValN(PrintAST, "print-ast",
                         "Print parsed AST nodes from the input file."),
              clEnumValN(Evaluate, "evaluate",
-                        "Print parsed AST nodes from the input file.")
+                        "Print parsed AST nodes from the input file."),
+             clEnumValN(Benchmark, "benchmark",
+                        "Replay the queries and report solver performance.")
              KLEE_LLVM_CL_VAL_END));
 
+  llvm::cl::opt<unsigned>
+  BenchmarkJobs("benchmark-jobs",
+                llvm::cl::desc("Number of worker processes replaying queries "
+                               "with -benchmark; each has its own solver "
+                               "chain and caches (default=1)"),
+                llvm::cl::init(1));
+
+  llvm::cl::opt<std::string>
+  BenchmarkResults("benchmark-results",
+                   llvm::cl::desc("Write the result, latency and answering "
+                                  "stage of each query to this file"),
+                   llvm::cl::init(""));
+
+  llvm::cl::opt<std::string>
+  BenchmarkCompare("benchmark-compare",
+                   llvm::cl::desc("Report queries whose result differs from "
+                                  "this -benchmark-results file"),
+                   llvm::cl::init(""));
+
 
   enum BuilderKinds {
     DefaultBuilder,
     ConstantFoldingBuilder,
-    SimplifyingBuilder
+    SimplifyingBuilder,
+    RewritingBuilder
   };
 
   static llvm::cl::opt<BuilderKinds> 
@@ -88,7 +117,10 @@ namespace {
               clEnumValN(ConstantFoldingBuilder, "constant-folding",
                          "Fold constant expressions."),
               clEnumValN(SimplifyingBuilder, "simplify",
-                         "Fold constants and simplify expressions.")
+                         "Fold constants and simplify expressions."),
+              clEnumValN(RewritingBuilder, "rewrite",
+                         "Simplify expressions and apply the expression "
+                         "rewrite rules.")
               KLEE_LLVM_CL_VAL_END));
 
 
@@ -194,6 +226,24 @@ static bool PrintInputAST(const char *Filename,
   return success;
 }
 
+static Solver *createSolver() {
+  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
+
+  if (CoreSolverToUse != DUMMY_SOLVER) {
+    if (0 != MaxCoreSolverTime) {
+      coreSolver->setCoreSolverTimeout(MaxCoreSolverTime);
+    }
+  }
+
+  return constructSolverChain(coreSolver,
+                              getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_KQUERY_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_KQUERY_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_BINARY_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_BINARY_FILE_NAME));
+}
+
 static bool EvaluateInputAST(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder) {
@@ -213,19 +263,7 @@ static bool EvaluateInputAST(const char *Filename,
   if (!success)
     return false;
 
-  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
-
-  if (CoreSolverToUse != DUMMY_SOLVER) {
-    if (0 != MaxCoreSolverTime) {
-      coreSolver->setCoreSolverTimeout(MaxCoreSolverTime);
-    }
-  }
-
-  Solver *S = constructSolverChain(coreSolver,
-                                   getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(ALL_QUERIES_KQUERY_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_KQUERY_FILE_NAME));
+  Solver *S = createSolver();
 
   unsigned Index = 0;
   for (std::vector<Decl*>::iterator it = Decls.begin(),
@@ -326,6 +364,264 @@ static bool EvaluateInputAST(const char *Filename,
   return success;
 }
 
+namespace {
+  /// Outcome of one query replayed with -benchmark, as written by a
+  /// worker process.
+  struct BenchmarkRecord {
+    unsigned index;
+    uint64_t micros;
+    char result;
+    char stage;
+  };
+}
+
+static const char *getBenchmarkResultName(char result) {
+  switch (result) {
+  case 'V': return "VALID";
+  case 'I': return "INVALID";
+  default: return "FAIL";
+  }
+}
+
+static const char *getBenchmarkStageName(char stage) {
+  switch (stage) {
+  case 's': return "solver";
+  case 'x': return "cex-cache";
+  case 'c': return "cache";
+  default: return "other";
+  }
+}
+
+/// Run one query, returning 'V' if it is valid (or unsatisfiable), 'I'
+/// if it is invalid (or satisfiable) and 'F' if the solver failed.
+static char runBenchmarkQuery(Solver *S, QueryCommand *QC) {
+  ConstraintManager constraints(QC->Constraints);
+
+  if (QC->Values.empty() && QC->Objects.empty()) {
+    bool result;
+    if (!S->mustBeTrue(Query(constraints, QC->Query), result))
+      return 'F';
+    return result ? 'V' : 'I';
+  }
+
+  if (!QC->Values.empty()) {
+    ref<ConstantExpr> result;
+    return S->getValue(Query(constraints, QC->Values[0]), result) ? 'I' : 'F';
+  }
+
+  std::vector< std::vector<unsigned char> > result;
+  if (S->getInitialValues(Query(constraints, QC->Query), QC->Objects, result))
+    return 'I';
+  return S->impl->getOperationStatusCode() ==
+    SolverImpl::SOLVER_RUN_STATUS_TIMEOUT ? 'F' : 'V';
+}
+
+/// Replay every \a jobs-th query starting at \a worker, writing a
+/// BenchmarkRecord for each to \a out. The stage which answered a query
+/// is inferred from the solver statistics it updated.
+static void runBenchmarkWorker(const std::vector<QueryCommand*> &queries,
+                               unsigned worker, unsigned jobs, FILE *out) {
+  Solver *S = createSolver();
+  const Statistic &coreQueries =
+    *theStatisticManager->getStatisticByName("Queries");
+  const Statistic &cacheHits =
+    *theStatisticManager->getStatisticByName("QueryCacheHits");
+  const Statistic &cexCacheHits =
+    *theStatisticManager->getStatisticByName("QueryCexCacheHits");
+
+  for (unsigned i = worker; i < queries.size(); i += jobs) {
+    uint64_t q = coreQueries, c = cacheHits, x = cexCacheHits;
+    double start = util::getWallTime();
+
+    BenchmarkRecord record;
+    record.index = i;
+    record.result = runBenchmarkQuery(S, queries[i]);
+    record.micros = (uint64_t) ((util::getWallTime() - start) * 1e6);
+    if (coreQueries != q)
+      record.stage = 's';
+    else if (cexCacheHits != x)
+      record.stage = 'x';
+    else if (cacheHits != c)
+      record.stage = 'c';
+    else
+      record.stage = 'o';
+    fwrite(&record, sizeof(record), 1, out);
+  }
+
+  delete S;
+  fflush(out);
+}
+
+static uint64_t getPercentile(const std::vector<uint64_t> &sorted,
+                              double p) {
+  if (sorted.empty())
+    return 0;
+  size_t i = (size_t) (p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+/// Compare against a -benchmark-results file of another configuration,
+/// returning false if any query has a different, definite result.
+static bool compareBenchmarkResults(const std::vector<BenchmarkRecord> &records,
+                                    const std::string &path) {
+  std::ifstream in(path.c_str());
+  if (!in) {
+    llvm::errs() << "error: unable to open " << path << "\n";
+    return false;
+  }
+
+  unsigned mismatches = 0, compared = 0;
+  uint64_t micros = 0, otherMicros = 0;
+  unsigned index;
+  std::string result, stage;
+  uint64_t time;
+  while (in >> index >> result >> time >> stage) {
+    if (index >= records.size())
+      continue;
+    ++compared;
+    micros += records[index].micros;
+    otherMicros += time;
+
+    std::string ours = getBenchmarkResultName(records[index].result);
+    if (ours != result && ours != "FAIL" && result != "FAIL") {
+      llvm::outs() << "Query " << index << ": " << ours << " (was "
+                   << result << ")\n";
+      ++mismatches;
+    }
+  }
+
+  llvm::outs() << "compared queries = " << compared << "\n"
+               << "mismatching results = " << mismatches << "\n"
+               << "total latency = " << micros / 1e6 << "s (was "
+               << otherMicros / 1e6 << "s)\n";
+  return mismatches == 0;
+}
+
+/// Replay the queries of a log across worker processes and report
+/// throughput, latency and which stage of the solver chain answered.
+static bool BenchmarkInputAST(const char *Filename,
+                              const MemoryBuffer *MB,
+                              ExprBuilder *Builder) {
+  std::vector<Decl*> Decls;
+  Parser *P = Parser::Create(Filename, MB, Builder, ClearArrayAfterQuery);
+  P->SetMaxErrors(20);
+  while (Decl *D = P->ParseTopLevelDecl()) {
+    Decls.push_back(D);
+  }
+
+  if (unsigned N = P->GetNumErrors()) {
+    llvm::errs() << Filename << ": parse failure: " << N << " errors.\n";
+    return false;
+  }
+
+  std::vector<QueryCommand*> queries;
+  for (std::vector<Decl*>::iterator it = Decls.begin(),
+         ie = Decls.end(); it != ie; ++it)
+    if (QueryCommand *QC = dyn_cast<QueryCommand>(*it))
+      queries.push_back(QC);
+
+  unsigned jobs = std::max(1u, BenchmarkJobs.getValue());
+  std::vector<FILE*> outputs;
+  std::vector<pid_t> workers;
+  bool success = true;
+
+  double start = util::getWallTime();
+  for (unsigned i = 0; i < jobs; ++i) {
+    FILE *out = tmpfile();
+    if (!out) {
+      llvm::errs() << "error: unable to create temporary file\n";
+      return false;
+    }
+    llvm::outs().flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      llvm::errs() << "error: unable to fork worker\n";
+      return false;
+    }
+    if (pid == 0) {
+      runBenchmarkWorker(queries, i, jobs, out);
+      _exit(0);
+    }
+    outputs.push_back(out);
+    workers.push_back(pid);
+  }
+
+  for (unsigned i = 0; i < jobs; ++i) {
+    int status;
+    if (waitpid(workers[i], &status, 0) < 0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status)) {
+      llvm::errs() << "warning: benchmark worker " << i << " failed\n";
+      success = false;
+    }
+  }
+  double elapsed = util::getWallTime() - start;
+
+  // Queries a failed worker did not get to count as failures.
+  std::vector<BenchmarkRecord> records(queries.size());
+  for (unsigned i = 0; i < records.size(); ++i) {
+    records[i].index = i;
+    records[i].micros = 0;
+    records[i].result = 'F';
+    records[i].stage = 'o';
+  }
+  for (unsigned i = 0; i < jobs; ++i) {
+    BenchmarkRecord record;
+    rewind(outputs[i]);
+    while (fread(&record, sizeof(record), 1, outputs[i]) == 1)
+      if (record.index < records.size())
+        records[record.index] = record;
+    fclose(outputs[i]);
+  }
+
+  std::vector<uint64_t> latencies;
+  std::map<char, unsigned> stages, results;
+  for (unsigned i = 0; i < records.size(); ++i) {
+    latencies.push_back(records[i].micros);
+    ++stages[records[i].stage];
+    ++results[records[i].result];
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  unsigned total = std::max(1u, (unsigned) records.size());
+  llvm::outs() << "queries = " << records.size() << "\n"
+               << "workers = " << jobs << "\n"
+               << "valid = " << results['V'] << ", invalid = "
+               << results['I'] << ", failed = " << results['F'] << "\n"
+               << "wall time = " << elapsed << "s\n"
+               << "throughput = " << records.size() / std::max(elapsed, 1e-6)
+               << " queries/s\n"
+               << "latency p50 = " << getPercentile(latencies, .5)
+               << "us, p99 = " << getPercentile(latencies, .99)
+               << "us, max = " << getPercentile(latencies, 1.) << "us\n";
+  const char stageKinds[] = { 's', 'x', 'c', 'o' };
+  for (unsigned i = 0; i < sizeof(stageKinds); ++i)
+    llvm::outs() << "answered by " << getBenchmarkStageName(stageKinds[i])
+                 << " = " << stages[stageKinds[i]] << " ("
+                 << 100. * stages[stageKinds[i]] / total << "%)\n";
+
+  if (!BenchmarkResults.empty()) {
+    std::ofstream out(BenchmarkResults.c_str());
+    if (!out) {
+      llvm::errs() << "error: unable to write " << BenchmarkResults << "\n";
+      success = false;
+    }
+    for (unsigned i = 0; i < records.size(); ++i)
+      out << i << " " << getBenchmarkResultName(records[i].result) << " "
+          << records[i].micros << " "
+          << getBenchmarkStageName(records[i].stage) << "\n";
+  }
+
+  if (!BenchmarkCompare.empty())
+    success &= compareBenchmarkResults(records, BenchmarkCompare);
+
+  for (std::vector<Decl*>::iterator it = Decls.begin(),
+         ie = Decls.end(); it != ie; ++it)
+    delete *it;
+  delete P;
+
+  return success;
+}
+
 static bool printInputAsSMTLIBv2(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder)
@@ -437,6 +733,12 @@ int main(int argc, char **argv) {
     Builder = createConstantFoldingExprBuilder(Builder);
     Builder = createSimplifyingExprBuilder(Builder);
     break;
+  case RewritingBuilder:
+    Builder = createDefaultExprBuilder();
+    Builder = createConstantFoldingExprBuilder(Builder);
+    Builder = createSimplifyingExprBuilder(Builder);
+    Builder = createRewritingExprBuilder(Builder);
+    break;
   }
 
   switch (ToolAction) {
@@ -451,6 +753,10 @@ int main(int argc, char **argv) {
     success = EvaluateInputAST(InputFile=="-" ? "<stdin>" : InputFile.c_str(),
                                MB.get(), Builder);
     break;
+  case Benchmark:
+    success = BenchmarkInputAST(InputFile=="-" ? "<stdin>" : InputFile.c_str(),
+                                MB.get(), Builder);
+    break;
   case PrintSMTLIBv2:
     success = printInputAsSMTLIBv2(InputFile=="-"? "<stdin>" : InputFile.c_str(), MB.get(),Builder);
     break;
@@ -0,0 +1,344 @@
+//===-- fork-server.c -----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee-replay.h"
+
+#include "klee/Internal/ADT/KTest.h"
+#include "klee/Internal/ADT/KTestArchive.h"
+#include "klee/Internal/ADT/KTestForkServer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+typedef struct {
+  pid_t pid;
+  int ctl_fd, status_fd, shm_fd;
+  size_t shm_size;
+  /* The child running a test, or 0 if the server is idle. */
+  pid_t child;
+  char test_name[PATH_MAX + 16];
+  time_t start;
+  int timed_out;
+} fork_server_t;
+
+/* The tests named on the command line, read one at a time. */
+typedef struct {
+  char **files;
+  unsigned num_files, file_index;
+  KTestArchive *archive;
+  unsigned archive_index;
+} test_source_t;
+
+static const char *progname;
+
+static int read_all(int fd, void *buf, size_t count) {
+  char *p = buf;
+  while (count) {
+    ssize_t n = read(fd, p, count);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    count -= n;
+  }
+  return 1;
+}
+
+static int write_all(int fd, const void *buf, size_t count) {
+  const char *p = buf;
+  while (count) {
+    ssize_t n = write(fd, p, count);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    count -= n;
+  }
+  return 1;
+}
+
+static void fatal(const char *msg, const char *arg) {
+  fprintf(stderr, "%s: error: %s%s\n", progname, msg, arg ? arg : "");
+  exit(1);
+}
+
+/* Returns the next test, or NULL once all were read. */
+static KTest *next_test(test_source_t *src, char *name, size_t name_size) {
+  for (;;) {
+    if (src->archive) {
+      if (src->archive_index < kTestArchive_numTests(src->archive)) {
+        unsigned i = src->archive_index++;
+        KTest *test = kTestArchive_getTest(src->archive, i);
+        snprintf(name, name_size, "%s:%u", src->files[src->file_index - 1],
+                 kTestArchive_getId(src->archive, i));
+        if (!test)
+          fatal("invalid test ", name);
+        return test;
+      }
+      kTestArchive_close(src->archive);
+      src->archive = 0;
+    }
+
+    if (src->file_index == src->num_files)
+      return 0;
+
+    char *file = src->files[src->file_index++];
+    if (kTestArchive_isArchiveFile(file)) {
+      src->archive = kTestArchive_open(file);
+      src->archive_index = 0;
+      if (!src->archive)
+        fatal("invalid input file ", file);
+      continue;
+    }
+
+    KTest *test = kTest_fromFile(file);
+    if (!test)
+      fatal("invalid input file ", file);
+    snprintf(name, name_size, "%s", file);
+    return test;
+  }
+}
+
+static int create_shared_memory(void) {
+  const char *dirs[] = { "/dev/shm", P_tmpdir, "/tmp" };
+  unsigned i;
+
+  for (i = 0; i != sizeof(dirs) / sizeof(dirs[0]); ++i) {
+    char path[PATH_MAX];
+    int fd;
+    snprintf(path, sizeof(path), "%s/klee-replay-XXXXXX", dirs[i]);
+    if ((fd = mkstemp(path)) >= 0) {
+      unlink(path);
+      return fd;
+    }
+  }
+  fatal("unable to create shared memory", 0);
+  return -1;
+}
+
+static void start_server(fork_server_t *server, char *executable) {
+  int ctl[2], status[2];
+  uint32_t hello;
+
+  server->shm_fd = create_shared_memory();
+  server->shm_size = 0;
+  server->child = 0;
+
+  if (pipe(ctl) || pipe(status))
+    fatal("unable to create pipe: ", strerror(errno));
+
+  server->pid = fork();
+  if (server->pid < 0)
+    fatal("unable to fork: ", strerror(errno));
+
+  if (server->pid == 0) {
+    char fds[64];
+    char *argv[] = { executable, 0 };
+
+    close(ctl[1]);
+    close(status[0]);
+    snprintf(fds, sizeof(fds), "%d,%d,%d", ctl[0], status[1], server->shm_fd);
+    setenv(KTEST_FORK_SERVER_ENV, fds, 1);
+    execv(executable, argv);
+    perror("execv");
+    _exit(66);
+  }
+
+  close(ctl[0]);
+  close(status[1]);
+  server->ctl_fd = ctl[1];
+  server->status_fd = status[0];
+  /* Keep the other servers from holding on to the pipes. */
+  fcntl(server->ctl_fd, F_SETFD, FD_CLOEXEC);
+  fcntl(server->status_fd, F_SETFD, FD_CLOEXEC);
+  fcntl(server->shm_fd, F_SETFD, FD_CLOEXEC);
+
+  if (!read_all(server->status_fd, &hello, sizeof hello) ||
+      hello != KTEST_FORK_SERVER_HELLO)
+    fatal("no fork server started, is the program linked with "
+          "libkleeRuntest? ", executable);
+}
+
+/* Write test to the shared memory of server, see KTestForkServer.h. */
+static uint32_t write_shared_test(fork_server_t *server, KTest *test) {
+  size_t size = 4;
+  unsigned char *p;
+  void *shm;
+  unsigned i;
+
+  for (i = 0; i != test->numObjects; ++i)
+    size += 8 + strlen(test->objects[i].name) + 1 + test->objects[i].numBytes;
+  if (size > UINT32_MAX)
+    fatal("test too large: ", server->test_name);
+
+  if (size > server->shm_size) {
+    if (ftruncate(server->shm_fd, size))
+      fatal("unable to resize shared memory: ", strerror(errno));
+    server->shm_size = size;
+  }
+
+  shm = mmap(0, size, PROT_WRITE, MAP_SHARED, server->shm_fd, 0);
+  if (shm == MAP_FAILED)
+    fatal("unable to map shared memory: ", strerror(errno));
+
+  p = shm;
+  memcpy(p, &test->numObjects, 4);
+  p += 4;
+  for (i = 0; i != test->numObjects; ++i) {
+    KTestObject *o = &test->objects[i];
+    uint32_t name_size = strlen(o->name) + 1;
+    memcpy(p, &name_size, 4);
+    memcpy(p + 4, &o->numBytes, 4);
+    p += 8;
+    memcpy(p, o->name, name_size);
+    p += name_size;
+    memcpy(p, o->bytes, o->numBytes);
+    p += o->numBytes;
+  }
+
+  munmap(shm, size);
+  return size;
+}
+
+static void run_test(fork_server_t *server, KTest *test) {
+  uint32_t size = write_shared_test(server, test), pid;
+
+  if (!write_all(server->ctl_fd, &size, sizeof size) ||
+      !read_all(server->status_fd, &pid, sizeof pid))
+    fatal("fork server died while starting test ", server->test_name);
+  server->child = pid;
+  server->start = time(0);
+  server->timed_out = 0;
+}
+
+static void finish_test(fork_server_t *server) {
+  uint32_t status;
+  int elapsed = time(0) - server->start;
+
+  if (!read_all(server->status_fd, &status, sizeof status))
+    fatal("fork server died while running test ", server->test_name);
+  server->child = 0;
+
+  fprintf(stderr, "%s: TEST CASE: %s\n", progname, server->test_name);
+  fprintf(stderr, "%s: ", progname);
+  if (server->timed_out) {
+    fprintf(stderr, "EXIT STATUS: TIMED OUT (%d seconds)\n", elapsed);
+  } else if (WIFSIGNALED(status)) {
+    fprintf(stderr, "EXIT STATUS: CRASHED signal %d (%d seconds)\n",
+            WTERMSIG(status), elapsed);
+  } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    fprintf(stderr, "EXIT STATUS: NORMAL (%d seconds)\n", elapsed);
+  } else if (WIFEXITED(status)) {
+    fprintf(stderr, "EXIT STATUS: ABNORMAL %d (%d seconds)\n",
+            WEXITSTATUS(status), elapsed);
+  } else {
+    fprintf(stderr, "EXIT STATUS: NONE (%d seconds)\n", elapsed);
+  }
+}
+
+int replay_fork_server(const char *prog, char *executable, unsigned jobs,
+                       char **files, unsigned num_files) {
+  fork_server_t *servers = calloc(jobs, sizeof(*servers));
+  struct pollfd *fds = calloc(jobs, sizeof(*fds));
+  test_source_t src = { files, num_files, 0, 0, 0 };
+  const char *t = getenv("KLEE_REPLAY_TIMEOUT");
+  unsigned i, busy = 0, timeout = t ? atoi(t) : 10000000;
+  int done = 0;
+
+  progname = prog;
+  if (!servers || !fds)
+    fatal("out of memory", 0);
+  if (timeout == 0)
+    fatal("invalid timeout ", t);
+
+  for (i = 0; i != jobs; ++i)
+    start_server(&servers[i], executable);
+
+  for (;;) {
+    int wait_ms = -1;
+    time_t now;
+
+    for (i = 0; i != jobs && !done; ++i) {
+      fork_server_t *server = &servers[i];
+      KTest *test;
+      if (server->child)
+        continue;
+      test = next_test(&src, server->test_name, sizeof(server->test_name));
+      if (!test) {
+        done = 1;
+        break;
+      }
+      run_test(server, test);
+      kTest_free(test);
+      ++busy;
+    }
+    if (!busy)
+      break;
+
+    now = time(0);
+    for (i = 0; i != jobs; ++i) {
+      fork_server_t *server = &servers[i];
+      fds[i].fd = server->child ? server->status_fd : -1;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+      if (server->child && !server->timed_out) {
+        long left = (long) server->start + timeout - now;
+        int ms = left > 0 ? (left > INT_MAX / 1000 ? INT_MAX : left * 1000) : 0;
+        if (wait_ms < 0 || ms < wait_ms)
+          wait_ms = ms;
+      }
+    }
+
+    if (poll(fds, jobs, wait_ms) < 0 && errno != EINTR)
+      fatal("poll failed: ", strerror(errno));
+
+    now = time(0);
+    for (i = 0; i != jobs; ++i) {
+      fork_server_t *server = &servers[i];
+      if (!server->child)
+        continue;
+      if (fds[i].revents) {
+        finish_test(server);
+        --busy;
+      } else if (!server->timed_out &&
+                 now >= server->start + (time_t) timeout) {
+        /* The server reports the status once the child is gone. */
+        server->timed_out = 1;
+        kill(server->child, SIGKILL);
+      }
+    }
+  }
+
+  for (i = 0; i != jobs; ++i) {
+    int status;
+    close(servers[i].ctl_fd);
+    close(servers[i].status_fd);
+    close(servers[i].shm_fd);
+    while (waitpid(servers[i].pid, &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+  free(servers);
+  free(fds);
+  return 0;
+}
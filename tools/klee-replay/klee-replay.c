@@ -10,6 +10,7 @@
 #include "klee-replay.h"
 
 #include "klee/Internal/ADT/KTest.h"
+#include "klee/Internal/ADT/KTestArchive.h"
 #include "klee/Config/config.h"
 
 #include <assert.h>
@@ -18,6 +19,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <getopt.h>
+#include <limits.h>
 
 #include <errno.h>
 #include <time.h>
@@ -33,15 +35,20 @@ static void __emit_error(const char *msg);
 
 static KTest* input;
 static unsigned obj_index;
+static unsigned num_replayed;
 
 static const char *progname = 0;
 static unsigned monitored_pid = 0;    
 static unsigned monitored_timeout;
 
 static char *rootdir = NULL;
+static int fork_server = 0;
+static unsigned jobs = 1;
 static struct option long_options[] = {
   {"create-files-only", required_argument, 0, 'f'},
   {"chroot-to-dir", required_argument, 0, 'r'},
+  {"fork-server", no_argument, 0, 's'},
+  {"jobs", required_argument, 0, 'j'},
   {"help", no_argument, 0, 'h'},
   {0, 0, 0, 0},
 };
@@ -244,11 +251,70 @@ void ensure_capsyschroot(const char *executable) {
 }
 #endif
 
+/* Replay the test in input. */
+static void replay_test(char *executable, char *prg_name,
+                        const char *test_name) {
+  int prg_argc;
+  char ** prg_argv;
+  char *arg0 = input->args[0];
+  unsigned i;
+
+  obj_index = 0;
+  prg_argc = input->numArgs;
+  prg_argv = input->args;
+  prg_argv[0] = prg_name;
+  klee_init_env(&prg_argc, &prg_argv);
+
+  if (num_replayed++)
+    fprintf(stderr, "\n");
+  fprintf(stderr, "%s: TEST CASE: %s\n", progname, test_name);
+  fprintf(stderr, "%s: ARGS: ", progname);
+  for (i=0; i != (unsigned) prg_argc; ++i) {
+    char *s = prg_argv[i];
+    if (s[0]=='A' && s[1] && !s[2]) s[1] = '\0';
+    fprintf(stderr, "\"%s\" ", prg_argv[i]); 
+  }
+  fprintf(stderr, "\n");
+
+  /* Run the test case machinery in a subprocess, eventually this parent
+     process should be a script or something which shells out to the actual
+     execution tool. */
+  int pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    _exit(66);
+  } else if (pid == 0) {
+    /* Create the input files, pipes, etc., and run the process. */
+    replay_create_files(&__exe_fs);
+    run_monitored(executable, prg_argc, prg_argv);
+    _exit(0);
+  } else {
+    /* Wait for the test case. */
+    int res, status;
+
+    do {
+      res = waitpid(pid, &status, 0);
+    } while (res < 0 && errno == EINTR);
+    
+    if (res < 0) {
+      perror("waitpid");
+      _exit(66);
+    }
+  }
+
+  /* The arguments are owned by input. */
+  input->args[0] = arg0;
+}
+
 static void usage(void) {
   fprintf(stderr, "Usage: %s [option]... <executable> <ktest-file>...\n", progname);
+  fprintf(stderr, "   (a <ktest-file> may also be a .ktar archive of tests)\n");
   fprintf(stderr, "   or: %s --create-files-only <ktest-file>\n", progname);
   fprintf(stderr, "\n");
   fprintf(stderr, "-r, --chroot-to-dir=DIR  use chroot jail, requires CAP_SYS_CHROOT\n");
+  fprintf(stderr, "    --fork-server        start the executable once and fork it for each\n");
+  fprintf(stderr, "                         test, requires linking it with libkleeRuntest\n");
+  fprintf(stderr, "-j, --jobs=N             run N fork servers in parallel (default 1)\n");
   fprintf(stderr, "-h, --help               display this help and exit\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "Use KLEE_REPLAY_TIMEOUT environment variable to set a timeout (in seconds).\n");
@@ -265,7 +331,7 @@ int main(int argc, char** argv) {
     usage();
 
   int c, opt_index;
-  while ((c = getopt_long(argc, argv, "f:r:", long_options, &opt_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "f:r:j:", long_options, &opt_index)) != -1) {
     switch (c) {
       case 'f': {
         /* Special case hack for only creating files and not actually executing
@@ -294,6 +360,14 @@ int main(int argc, char** argv) {
       case 'r':
         rootdir = optarg;
         break;
+      case 's':
+        fork_server = 1;
+        break;
+      case 'j':
+        jobs = atoi(optarg);
+        if (jobs == 0)
+          usage();
+        break;
     }
   }
 
@@ -321,60 +395,52 @@ int main(int argc, char** argv) {
   }
   fclose(f);
 
+  if (fork_server) {
+    if (rootdir) {
+      fprintf(stderr, "Error: --fork-server does not support chroot.\n");
+      exit(1);
+    }
+    return replay_fork_server(progname, executable, jobs, argv + optind + 1,
+                              argc - optind - 1);
+  }
+
   int idx = 0;
   for (idx = optind + 1; idx != argc; ++idx) {
     char* input_fname = argv[idx];
-    unsigned i;
-    
+
+    if (kTestArchive_isArchiveFile(input_fname)) {
+      KTestArchive *archive = kTestArchive_open(input_fname);
+      unsigned i;
+
+      if (!archive) {
+        fprintf(stderr, "%s: error: input file %s not valid.\n", progname,
+                input_fname);
+        exit(1);
+      }
+      for (i = 0; i != kTestArchive_numTests(archive); ++i) {
+        char test_name[PATH_MAX + 16];
+        snprintf(test_name, sizeof(test_name), "%s:%u", input_fname,
+                 kTestArchive_getId(archive, i));
+        input = kTestArchive_getTest(archive, i);
+        if (!input) {
+          fprintf(stderr, "%s: error: test %s not valid.\n", progname,
+                  test_name);
+          exit(1);
+        }
+        replay_test(executable, argv[optind], test_name);
+        kTest_free(input);
+      }
+      kTestArchive_close(archive);
+      continue;
+    }
+
     input = kTest_fromFile(input_fname);
     if (!input) {
       fprintf(stderr, "%s: error: input file %s not valid.\n", progname, 
               input_fname);
       exit(1);
     }
-    
-    obj_index = 0;
-    prg_argc = input->numArgs;
-    prg_argv = input->args;
-    prg_argv[0] = argv[optind];
-    klee_init_env(&prg_argc, &prg_argv);
-
-    if (idx > 2)
-      fprintf(stderr, "\n");
-    fprintf(stderr, "%s: TEST CASE: %s\n", progname, input_fname);
-    fprintf(stderr, "%s: ARGS: ", progname);
-    for (i=0; i != (unsigned) prg_argc; ++i) {
-      char *s = prg_argv[i];
-      if (s[0]=='A' && s[1] && !s[2]) s[1] = '\0';
-      fprintf(stderr, "\"%s\" ", prg_argv[i]); 
-    }
-    fprintf(stderr, "\n");
-
-    /* Run the test case machinery in a subprocess, eventually this parent
-       process should be a script or something which shells out to the actual
-       execution tool. */
-    int pid = fork();
-    if (pid < 0) {
-      perror("fork");
-      _exit(66);
-    } else if (pid == 0) {
-      /* Create the input files, pipes, etc., and run the process. */
-      replay_create_files(&__exe_fs);
-      run_monitored(executable, prg_argc, prg_argv);
-      _exit(0);
-    } else {
-      /* Wait for the test case. */
-      int res, status;
-
-      do {
-        res = waitpid(pid, &status, 0);
-      } while (res < 0 && errno == EINTR);
-      
-      if (res < 0) {
-        perror("waitpid");
-        _exit(66);
-      }
-    }
+    replay_test(executable, argv[optind], input_fname);
   }
 
   return 0;
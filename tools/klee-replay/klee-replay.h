@@ -19,6 +19,11 @@
 
 void replay_create_files(exe_file_system_t *exe_fs);
 
+/* Replay the tests in files, which may be .ktest files or archives, with
+   jobs fork servers of executable running in parallel. */
+int replay_fork_server(const char *progname, char *executable, unsigned jobs,
+                       char **files, unsigned num_files);
+
 void process_status(int status,
 		    time_t elapsed,
 		    const char *pfx)
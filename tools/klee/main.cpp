@@ -13,6 +13,7 @@
 #include "klee/ExecutionState.h"
 #include "klee/Expr.h"
 #include "klee/Internal/ADT/KTest.h"
+#include "klee/Internal/ADT/KTestArchive.h"
 #include "klee/Internal/ADT/TreeStream.h"
 #include "klee/Internal/Support/Debug.h"
 #include "klee/Internal/Support/ErrorHandling.h"
@@ -51,10 +52,14 @@
 #include <sys/wait.h>
 
 #include <cerrno>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 
 using namespace llvm;
@@ -115,6 +120,18 @@ namespace {
   WriteSymPaths("write-sym-paths",
                 cl::desc("Write .sym.path files for each test case"));
 
+  cl::opt<bool>
+  UseKTestArchive("ktest-archive",
+                  cl::desc("Write the test inputs to a single tests.ktar archive "
+                           "instead of a .ktest file per test (default=off)"),
+                  cl::init(false));
+
+  cl::opt<bool>
+  AsyncTestOutput("async-test-output",
+                  cl::desc("Write test case files on a background thread, "
+                           "while execution continues (default=off)"),
+                  cl::init(false));
+
   cl::opt<bool>
   OptExitOnError("exit-on-error",
               cl::desc("Exit if errors occur"));
@@ -212,11 +229,27 @@ extern cl::opt<double> MaxTime;
 
 /***/
 
+/// The contents of a test case, ready to be written out. It refers to no
+/// expressions or states, so it can be written on another thread.
+struct TestCaseOutput {
+  unsigned id;
+  bool hasSolution;
+  std::vector< std::pair<std::string, std::vector<unsigned char> > > objects;
+  /// The other files of the test case, as (suffix, contents) pairs.
+  std::vector< std::pair<std::string, std::string> > files;
+  /// Time spent on the test case before it was written.
+  double prepareTime;
+};
+
+class TestCaseWriter;
+
 class KleeHandler : public InterpreterHandler {
 private:
   Interpreter *m_interpreter;
   TreeStreamWriter *m_pathWriter, *m_symPathWriter;
   llvm::raw_ostream *m_infoFile;
+  TestCaseWriter *m_testWriter; // null unless --async-test-output
+  KTestArchiveWriter *m_testArchive; // null unless --ktest-archive
 
   SmallString<128> m_outputDirectory;
 
@@ -244,6 +277,19 @@ public:
                        const char *errorMessage,
                        const char *errorSuffix);
 
+  /// Write the files of a test case, appending any errors to \a errors.
+  /// Returns false if a solution was lost. May be called from the test
+  /// case writer thread.
+  bool writeTestCase(const TestCaseOutput &tc,
+                     std::vector<std::string> &errors);
+  void writeTestFile(unsigned id, const std::string &suffix,
+                     const std::string &contents,
+                     std::vector<std::string> &errors);
+  /// Wait until all test cases have been written.
+  void flushTestCases();
+  /// Report the errors of test cases written in the background.
+  void reportWriteErrors();
+
   std::string getOutputFilename(const std::string &filename);
   llvm::raw_fd_ostream *openOutputFile(const std::string &filename);
   std::string getTestFilename(const std::string &suffix, unsigned id);
@@ -256,12 +302,107 @@ public:
   static void getKTestFilesInDir(std::string directoryPath,
                                  std::vector<std::string> &results);
 
+  /// Load the test from a .ktest file, or all tests of a .ktar archive.
+  /// Returns false on error.
+  static bool loadKTests(const std::string &path, std::vector<KTest*> &tests);
+
   static std::string getRunTimeLibraryPath(const char *argv0);
 };
 
+/// TestCaseWriter - Writes test cases on a background thread, so that
+/// execution continues while their files are written. The thread takes
+/// all queued test cases at once and writes them as a batch.
+class TestCaseWriter {
+  /// The number of queued test cases at which processTestCase waits.
+  static const unsigned MaxPending = 1024;
+
+  KleeHandler &handler;
+  std::mutex lock;
+  /// Signalled when a test case is queued or the writer is stopped.
+  std::condition_variable queued;
+  /// Signalled when the thread takes or finishes a batch.
+  std::condition_variable progress;
+  std::deque<TestCaseOutput*> pending;
+  bool busy, done;
+  std::vector<std::string> errors;
+  unsigned lost;
+  std::thread worker;
+
+  void run() {
+    std::deque<TestCaseOutput*> batch;
+    std::vector<std::string> batchErrors;
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+      queued.wait(guard, [this] { return done || !pending.empty(); });
+      if (pending.empty())
+        break;
+      batch.swap(pending);
+      busy = true;
+      guard.unlock();
+      progress.notify_all();
+
+      unsigned batchLost = 0;
+      for (TestCaseOutput *tc : batch) {
+        if (!handler.writeTestCase(*tc, batchErrors))
+          ++batchLost;
+        delete tc;
+      }
+      batch.clear();
+
+      guard.lock();
+      errors.insert(errors.end(), batchErrors.begin(), batchErrors.end());
+      batchErrors.clear();
+      lost += batchLost;
+      busy = false;
+      progress.notify_all();
+    }
+  }
+
+public:
+  explicit TestCaseWriter(KleeHandler &_handler)
+      : handler(_handler), busy(false), done(false), lost(0),
+        worker(&TestCaseWriter::run, this) {}
+
+  ~TestCaseWriter() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done = true;
+    }
+    queued.notify_one();
+    worker.join();
+    for (TestCaseOutput *tc : pending)
+      delete tc;
+  }
+
+  /// Queue \a tc to be written, taking ownership of it.
+  void add(TestCaseOutput *tc) {
+    std::unique_lock<std::mutex> guard(lock);
+    progress.wait(guard, [this] { return pending.size() < MaxPending; });
+    pending.push_back(tc);
+    queued.notify_one();
+  }
+
+  /// Wait until all queued test cases have been written.
+  void flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    progress.wait(guard, [this] { return pending.empty() && !busy; });
+  }
+
+  /// Move the errors so far to \a out, and return the number of
+  /// solutions lost since the last call.
+  unsigned takeErrors(std::vector<std::string> &out) {
+    std::lock_guard<std::mutex> guard(lock);
+    out.swap(errors);
+    unsigned result = lost;
+    lost = 0;
+    return result;
+  }
+};
+
 KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0), m_infoFile(0),
-      m_outputDirectory(), m_numTotalTests(0), m_numGeneratedTests(0),
+      m_testWriter(0), m_testArchive(0), m_outputDirectory(), m_numTotalTests(0),
+      m_numGeneratedTests(0),
       m_pathsExplored(0), m_argc(argc), m_argv(argv) {
 
   // create output directory (OutputDir or "klee-out-<i>")
@@ -330,9 +471,23 @@ KleeHandler::KleeHandler(int argc, char **argv)
 
   // open info
   m_infoFile = openOutputFile("info");
+
+  if (UseKTestArchive && !NoOutput) {
+    file_path = getOutputFilename("tests.ktar");
+    if (!(m_testArchive = kTestArchive_create(file_path.c_str())))
+      klee_error("cannot open file \"%s\": %s", file_path.c_str(),
+                 strerror(errno));
+  }
+
+  if (AsyncTestOutput && !NoOutput)
+    m_testWriter = new TestCaseWriter(*this);
 }
 
 KleeHandler::~KleeHandler() {
+  flushTestCases();
+  delete m_testWriter;
+  if (m_testArchive && !kTestArchive_finish(m_testArchive))
+    klee_warning("unable to write the index of the test archive");
   delete m_pathWriter;
   delete m_symPathWriter;
   fclose(klee_warning_file);
@@ -395,74 +550,45 @@ void KleeHandler::processTestCase(const ExecutionState &state,
                                   const char *errorSuffix) {
   if (errorMessage && OptExitOnError) {
     m_interpreter->prepareForEarlyExit();
+    flushTestCases();
     klee_error("EXITING ON ERROR:\n%s\n", errorMessage);
   }
 
   if (!NoOutput) {
-    std::vector< std::pair<std::string, std::vector<unsigned char> > > out;
-    bool success = m_interpreter->getSymbolicSolution(state, out);
+    // Everything which needs the state or the solver is done here; only
+    // the file output is left to the writer thread.
+    TestCaseOutput *tc = new TestCaseOutput();
+    bool success = m_interpreter->getSymbolicSolution(state, tc->objects);
 
     if (!success)
       klee_warning("unable to get symbolic solution, losing test case");
 
     double start_time = util::getWallTime();
 
-    unsigned id = ++m_numTotalTests;
-
-    if (success) {
-      KTest b;
-      b.numArgs = m_argc;
-      b.args = m_argv;
-      b.symArgvs = 0;
-      b.symArgvLen = 0;
-      b.numObjects = out.size();
-      b.objects = new KTestObject[b.numObjects];
-      assert(b.objects);
-      for (unsigned i=0; i<b.numObjects; i++) {
-        KTestObject *o = &b.objects[i];
-        o->name = const_cast<char*>(out[i].first.c_str());
-        o->numBytes = out[i].second.size();
-        o->bytes = new unsigned char[o->numBytes];
-        assert(o->bytes);
-        std::copy(out[i].second.begin(), out[i].second.end(), o->bytes);
-      }
-
-      if (!kTest_toFile(&b, getOutputFilename(getTestFilename("ktest", id)).c_str())) {
-        klee_warning("unable to write output test case, losing it");
-      } else {
-        ++m_numGeneratedTests;
-      }
-
-      for (unsigned i=0; i<b.numObjects; i++)
-        delete[] b.objects[i].bytes;
-      delete[] b.objects;
-    }
+    tc->id = ++m_numTotalTests;
+    tc->hasSolution = success;
 
-    if (errorMessage) {
-      llvm::raw_ostream *f = openTestFile(errorSuffix, id);
-      *f << errorMessage;
-      delete f;
-    }
+    if (errorMessage)
+      tc->files.push_back(std::make_pair(errorSuffix, errorMessage));
 
     if (m_pathWriter) {
       std::vector<unsigned char> concreteBranches;
       m_pathWriter->readStream(m_interpreter->getPathStreamID(state),
                                concreteBranches);
-      llvm::raw_fd_ostream *f = openTestFile("path", id);
+      std::string contents;
       for (std::vector<unsigned char>::iterator I = concreteBranches.begin(),
                                                 E = concreteBranches.end();
            I != E; ++I) {
-        *f << *I << "\n";
+        contents += *I;
+        contents += '\n';
       }
-      delete f;
+      tc->files.push_back(std::make_pair("path", contents));
     }
 
     if (errorMessage || WriteKQueries) {
       std::string constraints;
       m_interpreter->getConstraintLog(state, constraints,Interpreter::KQUERY);
-      llvm::raw_ostream *f = openTestFile("kquery", id);
-      *f << constraints;
-      delete f;
+      tc->files.push_back(std::make_pair("kquery", constraints));
     }
 
     if (WriteCVCs) {
@@ -470,56 +596,150 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       // SMT-LIBv2 not CVC which is a bit confusing
       std::string constraints;
       m_interpreter->getConstraintLog(state, constraints, Interpreter::STP);
-      llvm::raw_ostream *f = openTestFile("cvc", id);
-      *f << constraints;
-      delete f;
+      tc->files.push_back(std::make_pair("cvc", constraints));
     }
 
     if(WriteSMT2s) {
       std::string constraints;
-        m_interpreter->getConstraintLog(state, constraints, Interpreter::SMTLIB2);
-        llvm::raw_ostream *f = openTestFile("smt2", id);
-        *f << constraints;
-        delete f;
+      m_interpreter->getConstraintLog(state, constraints, Interpreter::SMTLIB2);
+      tc->files.push_back(std::make_pair("smt2", constraints));
     }
 
     if (m_symPathWriter) {
       std::vector<unsigned char> symbolicBranches;
       m_symPathWriter->readStream(m_interpreter->getSymbolicPathStreamID(state),
                                   symbolicBranches);
-      llvm::raw_fd_ostream *f = openTestFile("sym.path", id);
+      std::string contents;
       for (std::vector<unsigned char>::iterator I = symbolicBranches.begin(), E = symbolicBranches.end(); I!=E; ++I) {
-        *f << *I << "\n";
+        contents += *I;
+        contents += '\n';
       }
-      delete f;
+      tc->files.push_back(std::make_pair("sym.path", contents));
     }
 
     if (WriteCov) {
       std::map<const std::string*, std::set<unsigned> > cov;
       m_interpreter->getCoveredLines(state, cov);
-      llvm::raw_ostream *f = openTestFile("cov", id);
+      std::string contents;
+      llvm::raw_string_ostream f(contents);
       for (std::map<const std::string*, std::set<unsigned> >::iterator
              it = cov.begin(), ie = cov.end();
            it != ie; ++it) {
         for (std::set<unsigned>::iterator
                it2 = it->second.begin(), ie = it->second.end();
              it2 != ie; ++it2)
-          *f << *it->first << ":" << *it2 << "\n";
+          f << *it->first << ":" << *it2 << "\n";
       }
-      delete f;
+      tc->files.push_back(std::make_pair("cov", f.str()));
+    }
+
+    tc->prepareTime = util::getWallTime() - start_time;
+
+    // Test cases written in the background are counted when queued, and
+    // uncounted if writing them fails.
+    if (success)
+      ++m_numGeneratedTests;
+
+    if (m_testWriter) {
+      m_testWriter->add(tc);
+      reportWriteErrors();
+    } else {
+      std::vector<std::string> errors;
+      if (!writeTestCase(*tc, errors))
+        --m_numGeneratedTests;
+      for (unsigned i = 0; i < errors.size(); ++i)
+        klee_warning("%s", errors[i].c_str());
+      delete tc;
     }
 
     if (m_numGeneratedTests == StopAfterNTests)
       m_interpreter->setHaltExecution(true);
+  }
+}
 
-    if (WriteTestInfo) {
-      double elapsed_time = util::getWallTime() - start_time;
-      llvm::raw_ostream *f = openTestFile("info", id);
-      *f << "Time to generate test case: "
-         << elapsed_time << "s\n";
-      delete f;
+bool KleeHandler::writeTestCase(const TestCaseOutput &tc,
+                                std::vector<std::string> &errors) {
+  double start_time = util::getWallTime();
+  bool written = true;
+
+  if (tc.hasSolution) {
+    KTest b;
+    b.numArgs = m_argc;
+    b.args = m_argv;
+    b.symArgvs = 0;
+    b.symArgvLen = 0;
+    b.numObjects = tc.objects.size();
+    b.objects = new KTestObject[b.numObjects];
+    assert(b.objects);
+    for (unsigned i=0; i<b.numObjects; i++) {
+      KTestObject *o = &b.objects[i];
+      o->name = const_cast<char*>(tc.objects[i].first.c_str());
+      o->numBytes = tc.objects[i].second.size();
+      o->bytes = new unsigned char[o->numBytes];
+      assert(o->bytes);
+      std::copy(tc.objects[i].second.begin(), tc.objects[i].second.end(),
+                o->bytes);
     }
+
+    if (m_testArchive ? !kTestArchive_add(m_testArchive, tc.id, &b)
+                      : !kTest_toFile(&b, getOutputFilename(getTestFilename("ktest", tc.id)).c_str())) {
+      errors.push_back("unable to write output test case, losing it");
+      written = false;
+    }
+
+    for (unsigned i=0; i<b.numObjects; i++)
+      delete[] b.objects[i].bytes;
+    delete[] b.objects;
+  }
+
+  for (unsigned i = 0; i < tc.files.size(); ++i)
+    writeTestFile(tc.id, tc.files[i].first, tc.files[i].second, errors);
+
+  if (WriteTestInfo) {
+    double elapsed_time = tc.prepareTime + (util::getWallTime() - start_time);
+    std::string info;
+    llvm::raw_string_ostream os(info);
+    os << "Time to generate test case: "
+       << elapsed_time << "s\n";
+    writeTestFile(tc.id, "info", os.str(), errors);
   }
+
+  return written;
+}
+
+void KleeHandler::writeTestFile(unsigned id, const std::string &suffix,
+                                const std::string &contents,
+                                std::vector<std::string> &errors) {
+  // Not openTestFile(), which warns on failure: this may run on the
+  // writer thread, so the errors are reported by the caller.
+  std::string error;
+  std::string path = getOutputFilename(getTestFilename(suffix, id));
+  llvm::raw_fd_ostream *f = klee_open_output_file(path, error);
+  if (!f) {
+    errors.push_back("error opening file \"" + path + "\".  KLEE may have "
+                     "run out of file descriptors: try to increase the "
+                     "maximum number of open file descriptors by using "
+                     "ulimit (" + error + ").");
+    return;
+  }
+  *f << contents;
+  delete f;
+}
+
+void KleeHandler::flushTestCases() {
+  if (!m_testWriter)
+    return;
+  m_testWriter->flush();
+  reportWriteErrors();
+}
+
+void KleeHandler::reportWriteErrors() {
+  if (!m_testWriter)
+    return;
+  std::vector<std::string> errors;
+  m_numGeneratedTests -= m_testWriter->takeErrors(errors);
+  for (unsigned i = 0; i < errors.size(); ++i)
+    klee_warning("%s", errors[i].c_str());
 }
 
   // load a .path file
@@ -548,7 +768,8 @@ void KleeHandler::getKTestFilesInDir(std::string directoryPath,
   for (llvm::sys::fs::directory_iterator i(directoryPath, ec), e; i != e && !ec;
        i.increment(ec)) {
     std::string f = (*i).path();
-    if (f.substr(f.size()-6,f.size()) == ".ktest") {
+    if (f.substr(f.size()-6,f.size()) == ".ktest" ||
+        (f.size() > 5 && f.substr(f.size()-5) == ".ktar")) {
           results.push_back(f);
     }
   }
@@ -560,6 +781,32 @@ void KleeHandler::getKTestFilesInDir(std::string directoryPath,
   }
 }
 
+bool KleeHandler::loadKTests(const std::string &path,
+                             std::vector<KTest*> &tests) {
+  if (!kTestArchive_isArchiveFile(path.c_str())) {
+    KTest *out = kTest_fromFile(path.c_str());
+    if (!out)
+      return false;
+    tests.push_back(out);
+    return true;
+  }
+
+  KTestArchive *archive = kTestArchive_open(path.c_str());
+  if (!archive)
+    return false;
+  bool success = true;
+  for (unsigned i = 0, e = kTestArchive_numTests(archive); i != e; ++i) {
+    KTest *out = kTestArchive_getTest(archive, i);
+    if (!out) {
+      success = false;
+      break;
+    }
+    tests.push_back(out);
+  }
+  kTestArchive_close(archive);
+  return success;
+}
+
 std::string KleeHandler::getRunTimeLibraryPath(const char *argv0) {
   // allow specifying the path to the runtime library
   const char *env = getenv("KLEE_RUNTIME_LIBRARY_PATH");
@@ -721,6 +968,7 @@ static const char *modelledExternals[] = {
   "klee_open_merge",
   "klee_close_merge",
   "klee_prefer_cex",
+  "klee_posix_copy_file_data",
   "klee_posix_prefer_cex",
   "klee_print_expr",
   "klee_print_range",
@@ -1313,9 +1561,17 @@ int main(int argc, char **argv, char **envp) {
   }
   handler->getInfoStream() << "PID: " << getpid() << "\n";
 
+  double setupStart = util::getWallTime();
   const Module *finalModule =
     interpreter->setModule(mainModule, Opts);
   externalsAndGlobalsCheck(finalModule);
+  // The module may have been replaced by a cached, prepared one.
+  mainFn = finalModule->getFunction(EntryPoint);
+
+  char setupTime[64];
+  snprintf(setupTime, sizeof(setupTime), "Module setup: %.2fs\n",
+           util::getWallTime() - setupStart);
+  handler->getInfoStream() << setupTime;
 
   if (ReplayPathFile != "") {
     interpreter->setReplayPath(&replayPath);
@@ -1341,12 +1597,8 @@ int main(int argc, char **argv, char **envp) {
     for (std::vector<std::string>::iterator
            it = kTestFiles.begin(), ie = kTestFiles.end();
          it != ie; ++it) {
-      KTest *out = kTest_fromFile(it->c_str());
-      if (out) {
-        kTests.push_back(out);
-      } else {
+      if (!KleeHandler::loadKTests(*it, kTests))
         klee_warning("unable to open: %s\n", (*it).c_str());
-      }
     }
 
     if (RunInDir != "") {
@@ -1365,7 +1617,7 @@ int main(int argc, char **argv, char **envp) {
       interpreter->setReplayKTest(out);
       llvm::errs() << "KLEE: replaying: " << *it << " (" << kTest_numBytes(out)
                    << " bytes)"
-                   << " (" << ++i << "/" << kTestFiles.size() << ")\n";
+                   << " (" << ++i << "/" << kTests.size() << ")\n";
       // XXX should put envp in .ktest ?
       interpreter->runFunctionAsMain(mainFn, out->numArgs, out->args, pEnvp);
       if (interrupted) break;
@@ -1380,11 +1632,9 @@ int main(int argc, char **argv, char **envp) {
     for (std::vector<std::string>::iterator
            it = SeedOutFile.begin(), ie = SeedOutFile.end();
          it != ie; ++it) {
-      KTest *out = kTest_fromFile(it->c_str());
-      if (!out) {
+      if (!KleeHandler::loadKTests(*it, seeds)) {
         klee_error("unable to open: %s\n", (*it).c_str());
       }
-      seeds.push_back(out);
     }
     for (std::vector<std::string>::iterator
            it = SeedOutDir.begin(), ie = SeedOutDir.end();
@@ -1394,11 +1644,9 @@ int main(int argc, char **argv, char **envp) {
       for (std::vector<std::string>::iterator
              it2 = kTestFiles.begin(), ie = kTestFiles.end();
            it2 != ie; ++it2) {
-        KTest *out = kTest_fromFile(it2->c_str());
-        if (!out) {
+        if (!KleeHandler::loadKTests(*it2, seeds)) {
           klee_error("unable to open: %s\n", (*it2).c_str());
         }
-        seeds.push_back(out);
       }
       if (kTestFiles.empty()) {
         klee_error("seeds directory is empty: %s\n", (*it).c_str());
@@ -1424,6 +1672,9 @@ int main(int argc, char **argv, char **envp) {
     }
   }
 
+  // Wait for the test cases still being written in the background.
+  handler->flushTestCases();
+
   t[1] = time(NULL);
   strftime(buf, sizeof(buf), "Finished: %Y-%m-%d %H:%M:%S\n", localtime(&t[1]));
   handler->getInfoStream() << buf;
@@ -0,0 +1,79 @@
+//===-- BitArrayTest.cpp ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "klee/util/BitArray.h"
+
+using namespace klee;
+
+namespace {
+
+const unsigned Size = 128;
+
+// Ranges starting and ending on either side of the word boundaries.
+const unsigned Starts[] = { 0, 1, 7, 31, 32, 33, 63, 64, 65, 95 };
+const unsigned Counts[] = { 0, 1, 2, 30, 31, 32, 33, 63, 64, 65 };
+
+TEST(BitArrayTest, SetRange) {
+  for (unsigned s = 0; s != sizeof(Starts) / sizeof(Starts[0]); ++s) {
+    for (unsigned c = 0; c != sizeof(Counts) / sizeof(Counts[0]); ++c) {
+      unsigned start = Starts[s], count = Counts[c];
+      if (start + count > Size)
+        continue;
+      BitArray ba(Size);
+      ba.setRange(start, count);
+      for (unsigned i = 0; i != Size; ++i)
+        ASSERT_EQ(i >= start && i < start + count, ba.get(i))
+          << "bit " << i << " after setRange(" << start << ", " << count
+          << ")";
+    }
+  }
+}
+
+TEST(BitArrayTest, IsAllSet) {
+  for (unsigned s = 0; s != sizeof(Starts) / sizeof(Starts[0]); ++s) {
+    for (unsigned c = 0; c != sizeof(Counts) / sizeof(Counts[0]); ++c) {
+      unsigned start = Starts[s], count = Counts[c];
+      if (start + count > Size)
+        continue;
+
+      BitArray ba(Size);
+      for (unsigned i = start; i != start + count; ++i)
+        ba.set(i);
+      EXPECT_TRUE(ba.isAllSet(start, count));
+
+      // Unsetting any single bit of the range, or shifting the range by one
+      // bit past either end, must be noticed.
+      for (unsigned i = start; i != start + count; ++i) {
+        ba.unset(i);
+        EXPECT_FALSE(ba.isAllSet(start, count))
+          << "bit " << i << " of isAllSet(" << start << ", " << count << ")";
+        ba.set(i);
+      }
+      if (count && start > 0)
+        EXPECT_FALSE(ba.isAllSet(start - 1, count));
+      if (count && start + count < Size)
+        EXPECT_FALSE(ba.isAllSet(start + 1, count));
+    }
+  }
+}
+
+TEST(BitArrayTest, AllSetArray) {
+  BitArray ba(Size, true);
+  EXPECT_TRUE(ba.isAllSet(0, Size));
+  ba.unset(Size - 1);
+  EXPECT_TRUE(ba.isAllSet(0, Size - 1));
+  EXPECT_FALSE(ba.isAllSet(33, Size - 33));
+}
+
+}